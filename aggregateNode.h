@@ -0,0 +1,128 @@
+#ifndef AGGREGATE_NODE_H
+#define AGGREGATE_NODE_H
+
+#include <limits>
+#include "splayTree.h"
+
+/**
+* Monoids for AggregateSplayNode. A monoid is a stateless type with two static members over Value:
+* identity(), and combine(a, b), which must be associative. combine is always called with its arguments
+* in key order, so it need not be commutative.
+*/
+template <typename Value>
+struct SumMonoid
+{
+	static Value identity()
+	{
+		return Value();
+	}
+
+	static Value combine(const Value& a, const Value& b)
+	{
+		return a + b;
+	}
+};
+
+template <typename Value>
+struct MinMonoid
+{
+	static Value identity()
+	{
+		return std::numeric_limits<Value>::max();
+	}
+
+	static Value combine(const Value& a, const Value& b)
+	{
+		return b < a ? b : a;
+	}
+};
+
+template <typename Value>
+struct MaxMonoid
+{
+	static Value identity()
+	{
+		return std::numeric_limits<Value>::lowest();
+	}
+
+	static Value combine(const Value& a, const Value& b)
+	{
+		return a < b ? b : a;
+	}
+};
+
+/**
+* A splay node that keeps the Monoid combination of every value in its subtree, in key order, which is
+* what SplayTree::aggregate reads. The aggregate is refreshed by recompute(), so the tree keeps it
+* current through rotations and splays. Values must be changed through the tree (insert) rather than
+* through an iterator, or the aggregates above the node go stale.
+*/
+template <typename Key, typename Value, typename Monoid>
+class AggregateSplayNode : public NodeBase<Key, Value, AggregateSplayNode<Key, Value, Monoid> >
+{
+public:
+	static const bool AUGMENTED = true;
+	typedef Monoid monoid_type;
+
+	AggregateSplayNode(const Key& key, const Value& value, AggregateSplayNode<Key, Value, Monoid>* parent);
+
+	const Value& getAggregate() const;
+	void setValue(const Value& value);
+	void recompute();
+
+protected:
+	Value mAggregate;
+};
+
+/**
+* A SplayTree that answers aggregate(lo, hi) under Monoid. The rest of the interface is the same as
+* SplayTree's.
+*/
+template <typename Key, typename Value, typename Monoid = SumMonoid<Value>,
+	typename Alloc = std::allocator<std::pair<const Key, Value> >, typename Compare = std::less<Key> >
+using AggregateSplayTree = SplayTree<Key, Value, AggregateSplayNode<Key, Value, Monoid>, Alloc, Compare>;
+
+/*
+	-------------------------------------------------------
+	Begin implementations for the AggregateSplayNode class.
+	-------------------------------------------------------
+*/
+
+template <typename Key, typename Value, typename Monoid>
+AggregateSplayNode<Key, Value, Monoid>::AggregateSplayNode(const Key& key, const Value& value, AggregateSplayNode<Key, Value, Monoid>* parent)
+	: NodeBase<Key, Value, AggregateSplayNode<Key, Value, Monoid> >(key, value, parent)
+	, mAggregate(value)
+{
+
+}
+
+template <typename Key, typename Value, typename Monoid>
+const Value& AggregateSplayNode<Key, Value, Monoid>::getAggregate() const
+{
+	return mAggregate;
+}
+
+//the node's own aggregate follows its value, the caller refreshes the ancestors
+template <typename Key, typename Value, typename Monoid>
+void AggregateSplayNode<Key, Value, Monoid>::setValue(const Value& value)
+{
+	this->mItem.second = value;
+	recompute();
+}
+
+//left subtree, then the node, then the right subtree
+template <typename Key, typename Value, typename Monoid>
+void AggregateSplayNode<Key, Value, Monoid>::recompute()
+{
+	mAggregate = this->mItem.second;
+	if(this->mLeft != nullptr) mAggregate = Monoid::combine(this->mLeft->getAggregate(), mAggregate);
+	if(this->mRight != nullptr) mAggregate = Monoid::combine(mAggregate, this->mRight->getAggregate());
+}
+
+/*
+	-----------------------------------------------------
+	End implementations for the AggregateSplayNode class.
+	-----------------------------------------------------
+*/
+
+#endif
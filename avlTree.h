@@ -0,0 +1,134 @@
+#ifndef AVL_TREE_H
+#define AVL_TREE_H
+
+#include "rotateBST.h"
+
+/**
+* A height-balanced search tree (Adelson-Velsky and Landis). The heights of the two subtrees of every
+* node differ by at most one, so every lookup is O(log n) in the worst case rather than amortized. The
+* interface is the same as SplayTree's, and lookups do not restructure the tree.
+*
+* NodeType must cache its height the way Node does.
+*/
+template <typename Key, typename Value, typename NodeType = Node<Key, Value>,
+	typename Alloc = std::allocator<std::pair<const Key, Value> >, typename Compare = std::less<Key> >
+class AVLTree : public rotateBST<Key, Value, NodeType, Alloc, Compare>
+{
+public:
+	explicit AVLTree(const Alloc& alloc = Alloc());
+	explicit AVLTree(const Compare& comp, const Alloc& alloc = Alloc());
+	typename AVLTree<Key, Value, NodeType, Alloc, Compare>::iterator insert(const std::pair<const Key, Value>& keyValuePair);
+	void remove(const Key& key);
+	void deleteMinLeaf();
+protected:
+	static int heightOf(const NodeType* node);
+	void rebalanceUpward(NodeType* node);
+private:
+	//an arbitrary shape need not be height-balanced (rebalance's always is, so it stays public)
+	using rotateBST<Key, Value, NodeType, Alloc, Compare>::transform;
+};
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+AVLTree<Key, Value, NodeType, Alloc, Compare>::AVLTree(const Alloc& alloc)
+	: rotateBST<Key, Value, NodeType, Alloc, Compare>(alloc)
+{
+
+}
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+AVLTree<Key, Value, NodeType, Alloc, Compare>::AVLTree(const Compare& comp, const Alloc& alloc)
+	: rotateBST<Key, Value, NodeType, Alloc, Compare>(comp, alloc)
+{
+
+}
+
+/**
+* Inserts a key/value pair, or overwrites the value if the key is already present, then restores the
+* balance on the way back up. Returns an iterator to the item.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename AVLTree<Key, Value, NodeType, Alloc, Compare>::iterator AVLTree<Key, Value, NodeType, Alloc, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+	if(this->mRoot == nullptr)
+	{
+		this->mRoot = this->createNode(keyValuePair.first, keyValuePair.second, nullptr);
+		return typename AVLTree<Key, Value, NodeType, Alloc, Compare>::iterator(this->mRoot, this);
+	}
+	NodeType* curr = this->mRoot;
+	int c;
+	while((c = this->compareKeys(keyValuePair.first, curr->getKey())) != 0)
+	{
+		NodeType* next = c < 0 ? curr->getLeft() : curr->getRight();
+		if(next == nullptr)
+		{
+			NodeType* new_node = this->createNode(keyValuePair.first, keyValuePair.second, curr);
+			if(c < 0) curr->setLeft(new_node);
+			else curr->setRight(new_node);
+			rebalanceUpward(curr);
+			return typename AVLTree<Key, Value, NodeType, Alloc, Compare>::iterator(new_node, this);
+		}
+		curr = next;
+	}
+	//key already in the tree, overwrite the value
+	curr->setValue(keyValuePair.second);
+	return typename AVLTree<Key, Value, NodeType, Alloc, Compare>::iterator(curr, this);
+}
+
+/**
+* Removes a key if it is present. A node with two children first trades places with its predecessor.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void AVLTree<Key, Value, NodeType, Alloc, Compare>::remove(const Key& key)
+{
+	NodeType* node = this->internalFind(key);
+	if(node == nullptr) return;
+	if(node->getLeft() != nullptr && node->getRight() != nullptr) this->swapWithPredecessor(node);
+	rebalanceUpward(this->spliceOut(node));
+}
+
+//removes the leaf reached by going left where possible
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void AVLTree<Key, Value, NodeType, Alloc, Compare>::deleteMinLeaf()
+{
+	NodeType* leaf = this->getMinLeaf();
+	if(leaf == nullptr) return;
+	rebalanceUpward(this->spliceOut(leaf));
+}
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+int AVLTree<Key, Value, NodeType, Alloc, Compare>::heightOf(const NodeType* node)
+{
+	return node == nullptr ? 0 : node->getHeight();
+}
+
+/**
+* Walks from node to the root, recomputing heights and rotating wherever the two subtrees of a node
+* differ in height by two. A child leaning the other way is rotated first (the double rotation cases).
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void AVLTree<Key, Value, NodeType, Alloc, Compare>::rebalanceUpward(NodeType* node)
+{
+	while(node != nullptr)
+	{
+		node->recompute();
+		int balance = heightOf(node->getLeft()) - heightOf(node->getRight());
+		if(balance > 1)
+		{
+			NodeType* left = node->getLeft();
+			if(heightOf(left->getLeft()) < heightOf(left->getRight())) this->leftRotate(left->getRight());
+			this->rightRotate(node->getLeft());
+			//node now hangs below the new root of this subtree
+			node = node->getParent();
+		}
+		else if(balance < -1)
+		{
+			NodeType* right = node->getRight();
+			if(heightOf(right->getRight()) < heightOf(right->getLeft())) this->rightRotate(right->getLeft());
+			this->leftRotate(node->getRight());
+			node = node->getParent();
+		}
+		node = node->getParent();
+	}
+}
+
+#endif
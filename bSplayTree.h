@@ -0,0 +1,1126 @@
+#ifndef B_SPLAY_TREE_H
+#define B_SPLAY_TREE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "bst.h"
+
+#if !defined(BST_NO_SIMD) && (defined(__GNUC__) || defined(__clang__)) && defined(__SSE2__)
+#include <immintrin.h>
+#define BSPLAY_SIMD 1
+#endif
+
+/**
+* Finds where a key goes among the sorted keys of a fat node: returns how many of keys[0, count) are
+* less than key under comp. The default is a binary search. Arithmetic keys under std::less are
+* specialized below to compare against a whole vector of keys per instruction, which on a node of one or
+* two cache lines is cheaper than the unpredictable branches of a binary search.
+*/
+template <typename Key, typename Compare>
+struct FatNodeSearch
+{
+	static std::size_t lowerBound(const Key* keys, std::size_t count, const Key& key, const Compare& comp)
+	{
+		return static_cast<std::size_t>(std::lower_bound(keys, keys + count, key, comp) - keys);
+	}
+};
+
+#if defined(BSPLAY_SIMD)
+//counts the keys below key four (or, with AVX2, eight) at a time; the tail is finished one by one
+template <>
+struct FatNodeSearch<std::int32_t, std::less<std::int32_t> >
+{
+	static std::size_t lowerBound(const std::int32_t* keys, std::size_t count, std::int32_t key, const std::less<std::int32_t>&)
+	{
+		std::size_t i = 0;
+		std::size_t below = 0;
+#if defined(__AVX2__)
+		const __m256i wide = _mm256_set1_epi32(key);
+		for(; i + 8 <= count; i += 8)
+		{
+			__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+			below += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(wide, block))));
+		}
+#endif
+		const __m128i narrow = _mm_set1_epi32(key);
+		for(; i + 4 <= count; i += 4)
+		{
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+			below += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(narrow, block))));
+		}
+		for(; i < count; i++) below += keys[i] < key;
+		return below;
+	}
+};
+
+#if defined(__SSE4_2__)
+//64-bit lanes need the SSE4.2 compare
+template <>
+struct FatNodeSearch<std::int64_t, std::less<std::int64_t> >
+{
+	static std::size_t lowerBound(const std::int64_t* keys, std::size_t count, std::int64_t key, const std::less<std::int64_t>&)
+	{
+		std::size_t i = 0;
+		std::size_t below = 0;
+#if defined(__AVX2__)
+		const __m256i wide = _mm256_set1_epi64x(key);
+		for(; i + 4 <= count; i += 4)
+		{
+			__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+			below += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(wide, block))));
+		}
+#endif
+		const __m128i narrow = _mm_set1_epi64x(key);
+		for(; i + 2 <= count; i += 2)
+		{
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+			below += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(narrow, block))));
+		}
+		for(; i < count; i++) below += keys[i] < key;
+		return below;
+	}
+};
+#endif
+#endif
+
+/**
+* A fat node for BSplayTree: up to Capacity items in key order, plus the usual three links. Every key in
+* the left subtree is below the node's first key and every key in the right subtree above its last one,
+* so the node acts as a single wide key during a descent. The keys are also kept in an array of their
+* own, packed into as few cache lines as possible, which is all a search reads; the items are only
+* touched once the key is found. A node in a tree is never empty.
+*/
+template <typename Key, typename Value, std::size_t Capacity>
+class BSplayNode
+{
+	static_assert(Capacity >= 2, "a fat node must hold at least two items to be split");
+
+public:
+	static const std::size_t CAPACITY = Capacity;
+
+	explicit BSplayNode(BSplayNode<Key, Value, Capacity>* parent);
+	~BSplayNode();
+
+	std::size_t getCount() const;
+	bool isFull() const;
+	const Key* getKeys() const;
+	const Key& getKey(std::size_t slot) const;
+	const Key& getMinKey() const;
+	const Key& getMaxKey() const;
+	const std::pair<const Key, Value>& getItem(std::size_t slot) const;
+	std::pair<const Key, Value>& getItem(std::size_t slot);
+
+	BSplayNode<Key, Value, Capacity>* getParent() const;
+	BSplayNode<Key, Value, Capacity>* getLeft() const;
+	BSplayNode<Key, Value, Capacity>* getRight() const;
+	void setParent(BSplayNode<Key, Value, Capacity>* parent);
+	void setLeft(BSplayNode<Key, Value, Capacity>* left);
+	void setRight(BSplayNode<Key, Value, Capacity>* right);
+
+	void insertAt(std::size_t slot, const std::pair<const Key, Value>& item);
+	void eraseAt(std::size_t slot);
+	void moveUpperHalfTo(BSplayNode<Key, Value, Capacity>* other);
+
+protected:
+	typedef typename std::aligned_storage<sizeof(Key), alignof(Key)>::type KeySlot;
+	typedef typename std::aligned_storage<sizeof(std::pair<const Key, Value>), alignof(std::pair<const Key, Value>)>::type ItemSlot;
+
+	Key* keyAt(std::size_t slot);
+	std::pair<const Key, Value>* itemAt(std::size_t slot);
+
+	BSplayNode<Key, Value, Capacity>* mParent;
+	BSplayNode<Key, Value, Capacity>* mLeft;
+	BSplayNode<Key, Value, Capacity>* mRight;
+	std::size_t mCount;
+	KeySlot mKeys[Capacity];
+	ItemSlot mItems[Capacity];
+};
+
+/**
+* A splay tree of fat nodes (see BSplayNode). Splaying works on whole nodes, so a tree of n keys has about
+* n / Capacity nodes and a lookup follows a path that many times shorter than in SplayTree, paying one
+* node (a cache line or two of keys) per step instead of one miss per comparison. Inside a node the key
+* is found with FatNodeSearch, which is vectorized for 32 and 64-bit integer keys under std::less.
+*
+* The interface is the same as SplayTree's insert, remove, find and iterators, so cacheLRU can use it as
+* its Tree; since items move between slots, cacheLRU keeps its entries out of line with this one (see
+* StableItems). Capacity defaults to two cache lines of keys.
+*/
+template <typename Key, typename Value, typename Alloc = std::allocator<std::pair<const Key, Value> >,
+	typename Compare = std::less<Key>, std::size_t Capacity = (sizeof(Key) <= 32 ? 128 / sizeof(Key) : 4)>
+class BSplayTree
+{
+public:
+	typedef BSplayNode<Key, Value, Capacity> NodeType;
+	typedef Alloc allocator_type;
+	typedef Compare key_compare;
+
+	explicit BSplayTree(const Alloc& alloc = Alloc());
+	explicit BSplayTree(const Compare& comp, const Alloc& alloc = Alloc());
+	BSplayTree(const BSplayTree<Key, Value, Alloc, Compare, Capacity>& other) = delete;
+	BSplayTree<Key, Value, Alloc, Compare, Capacity>& operator=(const BSplayTree<Key, Value, Alloc, Compare, Capacity>& other) = delete;
+	~BSplayTree();
+
+	class const_iterator;
+
+	/**
+	* A bidirectional iterator over the items in key order: a node and a slot within it. Moving an
+	* iterator never restructures the tree. Inserting or removing an item shifts the items of its node,
+	* so either invalidates the iterators into that node.
+	*/
+	class iterator
+	{
+		public:
+			typedef std::bidirectional_iterator_tag iterator_category;
+			typedef std::pair<const Key, Value> value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef std::pair<const Key, Value>* pointer;
+			typedef std::pair<const Key, Value>& reference;
+
+			iterator(NodeType* node, std::size_t slot, const BSplayTree<Key, Value, Alloc, Compare, Capacity>* tree);
+			iterator();
+
+			std::pair<const Key, Value>& operator*() const;
+			std::pair<const Key, Value>* operator->() const;
+
+			bool operator==(const iterator& rhs) const;
+			bool operator!=(const iterator& rhs) const;
+
+			iterator& operator++();
+			iterator operator++(int);
+			iterator& operator--();
+			iterator operator--(int);
+
+		protected:
+			friend class BSplayTree<Key, Value, Alloc, Compare, Capacity>;
+			friend class const_iterator;
+			NodeType* mNode;
+			std::size_t mSlot;
+			const BSplayTree<Key, Value, Alloc, Compare, Capacity>* mTree;
+	};
+
+	/**
+	* The read-only counterpart of iterator, which converts to it implicitly.
+	*/
+	class const_iterator
+	{
+		public:
+			typedef std::bidirectional_iterator_tag iterator_category;
+			typedef std::pair<const Key, Value> value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const std::pair<const Key, Value>* pointer;
+			typedef const std::pair<const Key, Value>& reference;
+
+			const_iterator(const iterator& it);
+			const_iterator();
+
+			const std::pair<const Key, Value>& operator*() const;
+			const std::pair<const Key, Value>* operator->() const;
+
+			bool operator==(const const_iterator& rhs) const;
+			bool operator!=(const const_iterator& rhs) const;
+
+			const_iterator& operator++();
+			const_iterator operator++(int);
+			const_iterator& operator--();
+			const_iterator operator--(int);
+
+		protected:
+			iterator mIt;
+	};
+
+	iterator begin();
+	iterator end();
+	const_iterator begin() const;
+	const_iterator end() const;
+	const_iterator cbegin() const;
+	const_iterator cend() const;
+
+	void insert(const std::pair<const Key, Value>& keyValuePair);
+	void remove(const Key& key);
+	iterator find(const Key& key);
+	iterator findMin();
+	iterator findMax();
+	void deleteMinLeaf();
+	void deleteMaxLeaf();
+	template <typename ForwardIt>
+	std::size_t insertBatch(ForwardIt first, ForwardIt last);
+	template <typename InputIt, typename OutputIt>
+	OutputIt findBatch(InputIt first, InputIt last, OutputIt out);
+	std::size_t size() const;
+	bool empty() const;
+	void clear();
+	NodeType* getRoot();
+	Compare key_comp() const;
+	Alloc get_allocator() const;
+
+protected:
+	typedef typename std::allocator_traits<Alloc>::template rebind_alloc<NodeType> NodeAllocator;
+	typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+
+	NodeType* createNode(NodeType* parent);
+	void destroyNode(NodeType* node);
+	NodeType* locate(const Key& key, std::size_t* slot, bool* found) const;
+	void eraseFrom(NodeType* node, std::size_t slot);
+	void unlink(NodeType* node);
+	void rotateUp(NodeType* node);
+	void splay(NodeType* node);
+	NodeType* getSmallestNode() const;
+	NodeType* getLargestNode() const;
+	static NodeType* successor(NodeType* node);
+	static NodeType* predecessor(NodeType* node);
+
+	NodeAllocator mAlloc;
+	Compare mCompare;
+	NodeType* mRoot;
+	std::size_t mSize;
+};
+
+/*
+	-----------------------------------------------
+	Begin implementations for the BSplayNode class.
+	-----------------------------------------------
+*/
+
+template <typename Key, typename Value, std::size_t Capacity>
+BSplayNode<Key, Value, Capacity>::BSplayNode(BSplayNode<Key, Value, Capacity>* parent)
+	: mParent(parent)
+	, mLeft(nullptr)
+	, mRight(nullptr)
+	, mCount(0)
+{
+
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+BSplayNode<Key, Value, Capacity>::~BSplayNode()
+{
+	for(std::size_t i = 0; i < mCount; i++)
+	{
+		keyAt(i)->~Key();
+		itemAt(i)->~pair();
+	}
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+std::size_t BSplayNode<Key, Value, Capacity>::getCount() const
+{
+	return mCount;
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+bool BSplayNode<Key, Value, Capacity>::isFull() const
+{
+	return mCount == Capacity;
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+const Key* BSplayNode<Key, Value, Capacity>::getKeys() const
+{
+	return reinterpret_cast<const Key*>(mKeys);
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+const Key& BSplayNode<Key, Value, Capacity>::getKey(std::size_t slot) const
+{
+	return getKeys()[slot];
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+const Key& BSplayNode<Key, Value, Capacity>::getMinKey() const
+{
+	return getKeys()[0];
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+const Key& BSplayNode<Key, Value, Capacity>::getMaxKey() const
+{
+	return getKeys()[mCount - 1];
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+const std::pair<const Key, Value>& BSplayNode<Key, Value, Capacity>::getItem(std::size_t slot) const
+{
+	return *reinterpret_cast<const std::pair<const Key, Value>*>(&mItems[slot]);
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+std::pair<const Key, Value>& BSplayNode<Key, Value, Capacity>::getItem(std::size_t slot)
+{
+	return *itemAt(slot);
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+BSplayNode<Key, Value, Capacity>* BSplayNode<Key, Value, Capacity>::getParent() const
+{
+	return mParent;
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+BSplayNode<Key, Value, Capacity>* BSplayNode<Key, Value, Capacity>::getLeft() const
+{
+	return mLeft;
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+BSplayNode<Key, Value, Capacity>* BSplayNode<Key, Value, Capacity>::getRight() const
+{
+	return mRight;
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+void BSplayNode<Key, Value, Capacity>::setParent(BSplayNode<Key, Value, Capacity>* parent)
+{
+	mParent = parent;
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+void BSplayNode<Key, Value, Capacity>::setLeft(BSplayNode<Key, Value, Capacity>* left)
+{
+	mLeft = left;
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+void BSplayNode<Key, Value, Capacity>::setRight(BSplayNode<Key, Value, Capacity>* right)
+{
+	mRight = right;
+}
+
+/**
+* Puts item at slot, shifting the items from slot on up by one. The node must not be full.
+*/
+template <typename Key, typename Value, std::size_t Capacity>
+void BSplayNode<Key, Value, Capacity>::insertAt(std::size_t slot, const std::pair<const Key, Value>& item)
+{
+	for(std::size_t i = mCount; i > slot; i--)
+	{
+		::new(static_cast<void*>(keyAt(i))) Key(std::move(*keyAt(i - 1)));
+		keyAt(i - 1)->~Key();
+		::new(static_cast<void*>(itemAt(i))) std::pair<const Key, Value>(std::move(*itemAt(i - 1)));
+		itemAt(i - 1)->~pair();
+	}
+	::new(static_cast<void*>(keyAt(slot))) Key(item.first);
+	::new(static_cast<void*>(itemAt(slot))) std::pair<const Key, Value>(item);
+	mCount++;
+}
+
+/**
+* Destroys the item at slot and shifts the items after it down by one.
+*/
+template <typename Key, typename Value, std::size_t Capacity>
+void BSplayNode<Key, Value, Capacity>::eraseAt(std::size_t slot)
+{
+	keyAt(slot)->~Key();
+	itemAt(slot)->~pair();
+	for(std::size_t i = slot + 1; i < mCount; i++)
+	{
+		::new(static_cast<void*>(keyAt(i - 1))) Key(std::move(*keyAt(i)));
+		keyAt(i)->~Key();
+		::new(static_cast<void*>(itemAt(i - 1))) std::pair<const Key, Value>(std::move(*itemAt(i)));
+		itemAt(i)->~pair();
+	}
+	mCount--;
+}
+
+/**
+* Moves the upper half of the items to the front of other, which must be empty.
+*/
+template <typename Key, typename Value, std::size_t Capacity>
+void BSplayNode<Key, Value, Capacity>::moveUpperHalfTo(BSplayNode<Key, Value, Capacity>* other)
+{
+	std::size_t keep = mCount / 2;
+	for(std::size_t i = keep; i < mCount; i++)
+	{
+		::new(static_cast<void*>(other->keyAt(i - keep))) Key(std::move(*keyAt(i)));
+		keyAt(i)->~Key();
+		::new(static_cast<void*>(other->itemAt(i - keep))) std::pair<const Key, Value>(std::move(*itemAt(i)));
+		itemAt(i)->~pair();
+	}
+	other->mCount = mCount - keep;
+	mCount = keep;
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+Key* BSplayNode<Key, Value, Capacity>::keyAt(std::size_t slot)
+{
+	return reinterpret_cast<Key*>(&mKeys[slot]);
+}
+
+template <typename Key, typename Value, std::size_t Capacity>
+std::pair<const Key, Value>* BSplayNode<Key, Value, Capacity>::itemAt(std::size_t slot)
+{
+	return reinterpret_cast<std::pair<const Key, Value>*>(&mItems[slot]);
+}
+
+/*
+	---------------------------------------------
+	End implementations for the BSplayNode class.
+	---------------------------------------------
+*/
+
+/*
+	---------------------------------------------------------
+	Begin implementations for the BSplayTree::iterator class.
+	---------------------------------------------------------
+*/
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator::iterator(NodeType* node, std::size_t slot, const BSplayTree<Key, Value, Alloc, Compare, Capacity>* tree)
+	: mNode(node)
+	, mSlot(slot)
+	, mTree(tree)
+{
+
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator::iterator()
+	: mNode(nullptr)
+	, mSlot(0)
+	, mTree(nullptr)
+{
+
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+std::pair<const Key, Value>& BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator::operator*() const
+{
+	return mNode->getItem(mSlot);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+std::pair<const Key, Value>* BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator::operator->() const
+{
+	return &(mNode->getItem(mSlot));
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+bool BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator::operator==(const BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator& rhs) const
+{
+	return mNode == rhs.mNode && mSlot == rhs.mSlot;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+bool BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator::operator!=(const BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator& rhs) const
+{
+	return !(*this == rhs);
+}
+
+//the next slot of the node, or the first slot of the next node
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator& BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator::operator++()
+{
+	if(++mSlot == mNode->getCount())
+	{
+		mNode = successor(mNode);
+		mSlot = 0;
+	}
+	return *this;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator::operator++(int)
+{
+	iterator old(*this);
+	++*this;
+	return old;
+}
+
+//from the end iterator, to the largest item
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator& BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator::operator--()
+{
+	if(mNode == nullptr) mNode = mTree->getLargestNode();
+	else if(mSlot > 0)
+	{
+		mSlot--;
+		return *this;
+	}
+	else mNode = predecessor(mNode);
+	mSlot = mNode->getCount() - 1;
+	return *this;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator::operator--(int)
+{
+	iterator old(*this);
+	--*this;
+	return old;
+}
+
+/*
+	-------------------------------------------------------
+	End implementations for the BSplayTree::iterator class.
+	-------------------------------------------------------
+*/
+
+/*
+	---------------------------------------------------------------
+	Begin implementations for the BSplayTree::const_iterator class.
+	---------------------------------------------------------------
+*/
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator::const_iterator(const BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator& it)
+	: mIt(it)
+{
+
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator::const_iterator()
+{
+
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+const std::pair<const Key, Value>& BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator::operator*() const
+{
+	return *mIt;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+const std::pair<const Key, Value>* BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator::operator->() const
+{
+	return &*mIt;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+bool BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator::operator==(const BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator& rhs) const
+{
+	return mIt == rhs.mIt;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+bool BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator::operator!=(const BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator& rhs) const
+{
+	return mIt != rhs.mIt;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator& BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator::operator++()
+{
+	++mIt;
+	return *this;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator::operator++(int)
+{
+	const_iterator old(*this);
+	++mIt;
+	return old;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator& BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator::operator--()
+{
+	--mIt;
+	return *this;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator::operator--(int)
+{
+	const_iterator old(*this);
+	--mIt;
+	return old;
+}
+
+/*
+	-------------------------------------------------------------
+	End implementations for the BSplayTree::const_iterator class.
+	-------------------------------------------------------------
+*/
+
+/*
+	-----------------------------------------------
+	Begin implementations for the BSplayTree class.
+	-----------------------------------------------
+*/
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+BSplayTree<Key, Value, Alloc, Compare, Capacity>::BSplayTree(const Alloc& alloc)
+	: mAlloc(alloc)
+	, mCompare()
+	, mRoot(nullptr)
+	, mSize(0)
+{
+
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+BSplayTree<Key, Value, Alloc, Compare, Capacity>::BSplayTree(const Compare& comp, const Alloc& alloc)
+	: mAlloc(alloc)
+	, mCompare(comp)
+	, mRoot(nullptr)
+	, mSize(0)
+{
+
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+BSplayTree<Key, Value, Alloc, Compare, Capacity>::~BSplayTree()
+{
+	clear();
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::begin()
+{
+	return iterator(getSmallestNode(), 0, this);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::end()
+{
+	return iterator(nullptr, 0, this);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::begin() const
+{
+	return iterator(getSmallestNode(), 0, this);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::end() const
+{
+	return iterator(nullptr, 0, this);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::cbegin() const
+{
+	return begin();
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::const_iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::cend() const
+{
+	return end();
+}
+
+/**
+* Inserts a key/value pair, or overwrites the value if the key is already present. The item goes into
+* the node whose range holds the key or, between two nodes, into the one the search ended on. A full
+* node is split first, its upper half moving to a new node that becomes its right child. The node that
+* received the item is splayed.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+void BSplayTree<Key, Value, Alloc, Compare, Capacity>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+	if(mRoot == nullptr)
+	{
+		mRoot = createNode(nullptr);
+		mRoot->insertAt(0, keyValuePair);
+		mSize++;
+		return;
+	}
+	std::size_t slot;
+	bool found;
+	NodeType* node = locate(keyValuePair.first, &slot, &found);
+	if(found)
+	{
+		node->getItem(slot).second = keyValuePair.second;
+		splay(node);
+		return;
+	}
+	if(node->isFull())
+	{
+		NodeType* upper = createNode(node);
+		node->moveUpperHalfTo(upper);
+		upper->setRight(node->getRight());
+		if(upper->getRight() != nullptr) upper->getRight()->setParent(upper);
+		node->setRight(upper);
+		if(slot > node->getCount())
+		{
+			slot -= node->getCount();
+			node = upper;
+		}
+	}
+	node->insertAt(slot, keyValuePair);
+	mSize++;
+	splay(node);
+}
+
+/**
+* Removes a key if it is present. A node left empty is taken out of the tree.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+void BSplayTree<Key, Value, Alloc, Compare, Capacity>::remove(const Key& key)
+{
+	if(mRoot == nullptr) return;
+	std::size_t slot;
+	bool found;
+	NodeType* node = locate(key, &slot, &found);
+	if(found) eraseFrom(node, slot);
+	else splay(node);
+}
+
+/**
+* Returns an iterator to the item with the given key, or the end iterator, and splays the node the
+* search ended on.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::find(const Key& key)
+{
+	if(mRoot == nullptr) return end();
+	std::size_t slot;
+	bool found;
+	NodeType* node = locate(key, &slot, &found);
+	splay(node);
+	if(!found) return end();
+	return iterator(node, slot, this);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::findMin()
+{
+	NodeType* node = getSmallestNode();
+	splay(node);
+	return iterator(node, 0, this);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::iterator BSplayTree<Key, Value, Alloc, Compare, Capacity>::findMax()
+{
+	NodeType* node = getLargestNode();
+	if(node == nullptr) return end();
+	splay(node);
+	return iterator(node, node->getCount() - 1, this);
+}
+
+//removes the smallest item of the leaf reached by going left where possible
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+void BSplayTree<Key, Value, Alloc, Compare, Capacity>::deleteMinLeaf()
+{
+	NodeType* node = mRoot;
+	if(node == nullptr) return;
+	while(node->getLeft() != nullptr || node->getRight() != nullptr)
+	{
+		node = node->getLeft() != nullptr ? node->getLeft() : node->getRight();
+	}
+	node->eraseAt(0);
+	mSize--;
+	if(node->getCount() == 0) unlink(node);
+}
+
+//the mirror image of deleteMinLeaf
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+void BSplayTree<Key, Value, Alloc, Compare, Capacity>::deleteMaxLeaf()
+{
+	NodeType* node = mRoot;
+	if(node == nullptr) return;
+	while(node->getLeft() != nullptr || node->getRight() != nullptr)
+	{
+		node = node->getRight() != nullptr ? node->getRight() : node->getLeft();
+	}
+	node->eraseAt(node->getCount() - 1);
+	mSize--;
+	if(node->getCount() == 0) unlink(node);
+}
+
+/**
+* Inserts the key/value pairs in [first, last) one by one and returns how many keys were new. Sorted
+* input fills each node before moving on to the next, so it is the cheap case.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+template <typename ForwardIt>
+std::size_t BSplayTree<Key, Value, Alloc, Compare, Capacity>::insertBatch(ForwardIt first, ForwardIt last)
+{
+	std::size_t before = mSize;
+	for(; first != last; ++first) insert(*first);
+	return mSize - before;
+}
+
+/**
+* Looks up the keys in [first, last) and writes one iterator per key to out, the end iterator for keys
+* that are missing. Returns out advanced past the results.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+template <typename InputIt, typename OutputIt>
+OutputIt BSplayTree<Key, Value, Alloc, Compare, Capacity>::findBatch(InputIt first, InputIt last, OutputIt out)
+{
+	for(; first != last; ++first, ++out) *out = find(*first);
+	return out;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+std::size_t BSplayTree<Key, Value, Alloc, Compare, Capacity>::size() const
+{
+	return mSize;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+bool BSplayTree<Key, Value, Alloc, Compare, Capacity>::empty() const
+{
+	return mSize == 0;
+}
+
+/**
+* Destroys every node. Left children are rotated up until the node at hand has none, and then it is
+* freed and its right child taken next, so no recursion or extra memory is needed however deep the tree.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+void BSplayTree<Key, Value, Alloc, Compare, Capacity>::clear()
+{
+	NodeType* node = mRoot;
+	while(node != nullptr)
+	{
+		NodeType* left = node->getLeft();
+		if(left != nullptr)
+		{
+			node->setLeft(left->getRight());
+			left->setRight(node);
+			node = left;
+		}
+		else
+		{
+			NodeType* right = node->getRight();
+			destroyNode(node);
+			node = right;
+		}
+	}
+	mRoot = nullptr;
+	mSize = 0;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::NodeType* BSplayTree<Key, Value, Alloc, Compare, Capacity>::getRoot()
+{
+	return mRoot;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+Compare BSplayTree<Key, Value, Alloc, Compare, Capacity>::key_comp() const
+{
+	return mCompare;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+Alloc BSplayTree<Key, Value, Alloc, Compare, Capacity>::get_allocator() const
+{
+	return Alloc(mAlloc);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::NodeType* BSplayTree<Key, Value, Alloc, Compare, Capacity>::createNode(NodeType* parent)
+{
+	NodeType* node = NodeAllocatorTraits::allocate(mAlloc, 1);
+	NodeAllocatorTraits::construct(mAlloc, node, parent);
+	return node;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+void BSplayTree<Key, Value, Alloc, Compare, Capacity>::destroyNode(NodeType* node)
+{
+	NodeAllocatorTraits::destroy(mAlloc, node);
+	NodeAllocatorTraits::deallocate(mAlloc, node, 1);
+}
+
+/**
+* Descends to the node whose range holds key, comparing only against each node's first and last keys on
+* the way, and searches its keys. Sets *found, and *slot to the slot of the key or the one it would be
+* inserted at. If no node's range holds the key, the last node on the path is returned, with *slot at
+* its front or back. The tree must not be empty.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::NodeType* BSplayTree<Key, Value, Alloc, Compare, Capacity>::locate(const Key& key, std::size_t* slot, bool* found) const
+{
+	NodeType* curr = mRoot;
+	while(true)
+	{
+		prefetchChildren(curr);
+		NodeType* next;
+		if(mCompare(key, curr->getMinKey()))
+		{
+			next = curr->getLeft();
+			*slot = 0;
+		}
+		else if(mCompare(curr->getMaxKey(), key))
+		{
+			next = curr->getRight();
+			*slot = curr->getCount();
+		}
+		else
+		{
+			*slot = FatNodeSearch<Key, Compare>::lowerBound(curr->getKeys(), curr->getCount(), key, mCompare);
+			*found = !mCompare(key, curr->getKey(*slot));
+			return curr;
+		}
+		if(next == nullptr)
+		{
+			*found = false;
+			return curr;
+		}
+		curr = next;
+	}
+}
+
+//removes the item at slot, and the node too if that leaves it empty
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+void BSplayTree<Key, Value, Alloc, Compare, Capacity>::eraseFrom(NodeType* node, std::size_t slot)
+{
+	node->eraseAt(slot);
+	mSize--;
+	splay(node);
+	if(node->getCount() == 0) unlink(node);
+}
+
+/**
+* Takes an empty node out of the tree and frees it. With two children the node is first splayed to the
+* root; its left subtree's largest node is then splayed to the top of that subtree, where it has no right
+* child, and takes the right subtree.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+void BSplayTree<Key, Value, Alloc, Compare, Capacity>::unlink(NodeType* node)
+{
+	NodeType* left = node->getLeft();
+	NodeType* right = node->getRight();
+	NodeType* parent = node->getParent();
+	NodeType* child;
+	if(left != nullptr && right != nullptr)
+	{
+		splay(node);
+		left->setParent(nullptr);
+		mRoot = left;
+		NodeType* max = left;
+		while(max->getRight() != nullptr) max = max->getRight();
+		splay(max);
+		max->setRight(right);
+		right->setParent(max);
+		destroyNode(node);
+		return;
+	}
+	child = left != nullptr ? left : right;
+	if(child != nullptr) child->setParent(parent);
+	if(parent == nullptr) mRoot = child;
+	else if(parent->getLeft() == node) parent->setLeft(child);
+	else parent->setRight(child);
+	destroyNode(node);
+}
+
+//one rotation that lifts node above its parent
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+void BSplayTree<Key, Value, Alloc, Compare, Capacity>::rotateUp(NodeType* node)
+{
+	NodeType* parent = node->getParent();
+	NodeType* grand = parent->getParent();
+	if(parent->getLeft() == node)
+	{
+		parent->setLeft(node->getRight());
+		if(node->getRight() != nullptr) node->getRight()->setParent(parent);
+		node->setRight(parent);
+	}
+	else
+	{
+		parent->setRight(node->getLeft());
+		if(node->getLeft() != nullptr) node->getLeft()->setParent(parent);
+		node->setLeft(parent);
+	}
+	parent->setParent(node);
+	node->setParent(grand);
+	if(grand == nullptr) mRoot = node;
+	else if(grand->getLeft() == parent) grand->setLeft(node);
+	else grand->setRight(node);
+}
+
+/**
+* Moves node to the root with the usual zig, zig-zig and zig-zag steps, treating each fat node as one key.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+void BSplayTree<Key, Value, Alloc, Compare, Capacity>::splay(NodeType* node)
+{
+	if(node == nullptr) return;
+	while(node->getParent() != nullptr)
+	{
+		NodeType* parent = node->getParent();
+		NodeType* grand = parent->getParent();
+		if(grand == nullptr) rotateUp(node);
+		else if((grand->getLeft() == parent) == (parent->getLeft() == node))
+		{
+			rotateUp(parent);
+			rotateUp(node);
+		}
+		else
+		{
+			rotateUp(node);
+			rotateUp(node);
+		}
+	}
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::NodeType* BSplayTree<Key, Value, Alloc, Compare, Capacity>::getSmallestNode() const
+{
+	NodeType* node = mRoot;
+	if(node != nullptr)
+	{
+		while(node->getLeft() != nullptr) node = node->getLeft();
+	}
+	return node;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::NodeType* BSplayTree<Key, Value, Alloc, Compare, Capacity>::getLargestNode() const
+{
+	NodeType* node = mRoot;
+	if(node != nullptr)
+	{
+		while(node->getRight() != nullptr) node = node->getRight();
+	}
+	return node;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::NodeType* BSplayTree<Key, Value, Alloc, Compare, Capacity>::successor(NodeType* node)
+{
+	if(node->getRight() != nullptr)
+	{
+		node = node->getRight();
+		while(node->getLeft() != nullptr) node = node->getLeft();
+		return node;
+	}
+	NodeType* parent = node->getParent();
+	while(parent != nullptr && node == parent->getRight())
+	{
+		node = parent;
+		parent = parent->getParent();
+	}
+	return parent;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+typename BSplayTree<Key, Value, Alloc, Compare, Capacity>::NodeType* BSplayTree<Key, Value, Alloc, Compare, Capacity>::predecessor(NodeType* node)
+{
+	if(node->getLeft() != nullptr)
+	{
+		node = node->getLeft();
+		while(node->getRight() != nullptr) node = node->getRight();
+		return node;
+	}
+	NodeType* parent = node->getParent();
+	while(parent != nullptr && node == parent->getLeft())
+	{
+		node = parent;
+		parent = parent->getParent();
+	}
+	return parent;
+}
+
+/*
+	---------------------------------------------
+	End implementations for the BSplayTree class.
+	---------------------------------------------
+*/
+
+#endif
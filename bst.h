@@ -7,17 +7,31 @@
 #include <utility>
 #include <iomanip>
 #include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "slabAllocator.h"
+#include "forkJoin.h"
+
+#if defined(__cpp_impl_three_way_comparison) && __cplusplus >= 202002L
+#include <compare>
+#endif
 
 /**
-* A templated class for a Node in a search tree. The getters for parent/left/right are virtual so that they
-* can be overridden for future kinds of search trees, such as Red Black trees, Splay trees, and AVL trees.
+* A templated base class for a Node in a search tree. Derived is the concrete node type (CRTP), so the
+* getters for parent/left/right return the derived type without a vtable, and each kind of search tree
+* (Red Black trees, Splay trees, AVL trees) picks the node layout it needs at compile time.
 */
-template <typename Key, typename Value>
-class Node 
+template <typename Key, typename Value, typename Derived>
+class NodeBase 
 {
 public:
-	Node(const Key& key, const Value& value, Node<Key, Value>* parent);
-	virtual ~Node();
+	//true if recompute() does something, so trees know whether it is worth walking up to call it
+	static const bool AUGMENTED = false;
+
+	NodeBase(const Key& key, const Value& value, Derived* parent);
 
 	const std::pair<const Key, Value>& getItem() const;
 	std::pair<const Key, Value>& getItem();
@@ -25,61 +39,68 @@ public:
 	const Value& getValue() const;
 	Value& getValue();
 
-	virtual Node<Key, Value>* getParent() const;
-	virtual Node<Key, Value>* getLeft() const;
-	virtual Node<Key, Value>* getRight() const;
-	int getHeight() const;
+	Derived* getParent() const;
+	Derived* getLeft() const;
+	Derived* getRight() const;
 
-	void setParent(Node<Key, Value>* parent);
-	void setLeft(Node<Key, Value>* left);
-	void setRight(Node<Key, Value>* right);
+	void setParent(Derived* parent);
+	void setLeft(Derived* left);
+	void setRight(Derived* right);
+	void setKey(const Key& key);
 	void setValue(const Value &value);
-	void setHeight(int height);
+	void recompute();
+	void copyBalance(const Derived& other);
 
 protected:
 	std::pair<const Key, Value> mItem;
-	Node<Key, Value>* mParent;
-	Node<Key, Value>* mLeft;
-	Node<Key, Value>* mRight;
+	Derived* mParent;
+	Derived* mLeft;
+	Derived* mRight;
+};
+
+/**
+* The default node, which also stores the height of its subtree for trees that balance on height.
+*/
+template <typename Key, typename Value>
+class Node : public NodeBase<Key, Value, Node<Key, Value> >
+{
+public:
+	static const bool AUGMENTED = true;
+
+	Node(const Key& key, const Value& value, Node<Key, Value>* parent);
+
+	int getHeight() const;
+	void setHeight(int height);
+	void recompute();
+
+protected:
 	int mHeight;
 };
 
 /*
-	-----------------------------------------
-	Begin implementations for the Node class.
-	-----------------------------------------
+	---------------------------------------------
+	Begin implementations for the NodeBase class.
+	---------------------------------------------
 */
 
 /**
 * Explicit constructor for a node.
 */
-template<typename Key, typename Value>
-Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) 
+template<typename Key, typename Value, typename Derived>
+NodeBase<Key, Value, Derived>::NodeBase(const Key& key, const Value& value, Derived* parent) 
 	: mItem(key, value)
 	, mParent(parent)
 	, mLeft(NULL)
 	, mRight(NULL)
-	, mHeight(1)
 { 
 
 } 
 
-/**
-* Destructor, which does not need to do anything since the pointers inside of a node
-* are only used as references to existing nodes. The nodes pointed to by parent/left/right
-* are freed within the clear() helper method in the BinarySearchTree.
-*/
-template<typename Key, typename Value>
-Node<Key, Value>::~Node() 
-{ 
-
-}
-
 /**
 * A const getter for the item.
 */
-template<typename Key, typename Value>
-const std::pair<const Key, Value>& Node<Key, Value>::getItem() const 
+template<typename Key, typename Value, typename Derived>
+const std::pair<const Key, Value>& NodeBase<Key, Value, Derived>::getItem() const 
 { 
 	return mItem; 
 }
@@ -87,8 +108,8 @@ const std::pair<const Key, Value>& Node<Key, Value>::getItem() const
 /**
 * A non-const getter for the item. 
 */
-template<typename Key, typename Value>
-std::pair<const Key, Value>& Node<Key, Value>::getItem() 
+template<typename Key, typename Value, typename Derived>
+std::pair<const Key, Value>& NodeBase<Key, Value, Derived>::getItem() 
 { 
 	return mItem; 
 }
@@ -96,8 +117,8 @@ std::pair<const Key, Value>& Node<Key, Value>::getItem()
 /**
 * A const getter for the key.
 */
-template<typename Key, typename Value>
-const Key& Node<Key, Value>::getKey() const 
+template<typename Key, typename Value, typename Derived>
+const Key& NodeBase<Key, Value, Derived>::getKey() const 
 { 
 	return mItem.first; 
 }
@@ -105,8 +126,8 @@ const Key& Node<Key, Value>::getKey() const
 /**
 * A const getter for the value.
 */
-template<typename Key, typename Value>
-const Value& Node<Key, Value>::getValue() const 
+template<typename Key, typename Value, typename Derived>
+const Value& NodeBase<Key, Value, Derived>::getValue() const 
 { 
 	return mItem.second; 
 }
@@ -114,53 +135,44 @@ const Value& Node<Key, Value>::getValue() const
 /**
 * A non-const getter for the value.
 */
-template<typename Key, typename Value>
-Value& Node<Key, Value>::getValue()
+template<typename Key, typename Value, typename Derived>
+Value& NodeBase<Key, Value, Derived>::getValue()
 {
 	return mItem.second;
 }
 
 /**
-* An implementation of the virtual function for retreiving the parent.
+* A getter for the parent.
 */
-template<typename Key, typename Value>
-Node<Key, Value>* Node<Key, Value>::getParent() const 
+template<typename Key, typename Value, typename Derived>
+Derived* NodeBase<Key, Value, Derived>::getParent() const 
 { 
 	return mParent; 
 }
 
 /**
-* An implementation of the virtual function for retreiving the left child.
+* A getter for the left child.
 */
-template<typename Key, typename Value>
-Node<Key, Value>* Node<Key, Value>::getLeft() const 
+template<typename Key, typename Value, typename Derived>
+Derived* NodeBase<Key, Value, Derived>::getLeft() const 
 { 
 	return mLeft; 
 }
 
 /**
-* An implementation of the virtual function for retreiving the right child. 
+* A getter for the right child. 
 */
-template<typename Key, typename Value>
-Node<Key, Value>* Node<Key, Value>::getRight() const 
+template<typename Key, typename Value, typename Derived>
+Derived* NodeBase<Key, Value, Derived>::getRight() const 
 { 
 	return mRight; 
 }
 
-/**
-* A const getter for the height.
-*/
-template<typename Key, typename Value>
-int Node<Key, Value>::getHeight() const
-{
-	return mHeight;
-}
-
 /**
 * A setter for setting the parent of a node.
 */
-template<typename Key, typename Value>
-void Node<Key, Value>::setParent(Node<Key, Value>* parent) 
+template<typename Key, typename Value, typename Derived>
+void NodeBase<Key, Value, Derived>::setParent(Derived* parent) 
 { 
 	mParent = parent; 
 }
@@ -168,8 +180,8 @@ void Node<Key, Value>::setParent(Node<Key, Value>* parent)
 /**
 * A setter for setting the left child of a node.
 */
-template<typename Key, typename Value>
-void Node<Key, Value>::setLeft(Node<Key, Value>* left) 
+template<typename Key, typename Value, typename Derived>
+void NodeBase<Key, Value, Derived>::setLeft(Derived* left) 
 { 
 	mLeft = left; 
 }
@@ -177,21 +189,83 @@ void Node<Key, Value>::setLeft(Node<Key, Value>* left)
 /**
 * A setter for setting the right child of a node.
 */
-template<typename Key, typename Value>
-void Node<Key, Value>::setRight(Node<Key, Value>* right) 
+template<typename Key, typename Value, typename Derived>
+void NodeBase<Key, Value, Derived>::setRight(Derived* right) 
 { 
 	mRight = right; 
 }
 
+/**
+* Gives the node a new key in place. The key is const to everyone outside the tree, and a tree may only
+* re-key a node it has cut out and links back in by the new key.
+*/
+template<typename Key, typename Value, typename Derived>
+void NodeBase<Key, Value, Derived>::setKey(const Key& key)
+{
+	const_cast<Key&>(mItem.first) = key;
+}
+
 /**
 * A setter for the value of a node.
 */
-template<typename Key, typename Value>
-void Node<Key, Value>::setValue(const Value& value) 
+template<typename Key, typename Value, typename Derived>
+void NodeBase<Key, Value, Derived>::setValue(const Value& value) 
 { 
 	mItem.second = value; 
 }
 
+/**
+* Recomputes whatever a node caches about its subtree after its children change. The base layout
+* caches nothing; derived layouts hide this with their own version.
+*/
+template<typename Key, typename Value, typename Derived>
+void NodeBase<Key, Value, Derived>::recompute() 
+{ 
+
+}
+
+/**
+* Copies whatever balancing state recompute cannot rebuild (a color, a priority) from the node this one
+* is a copy of. The base layout has none; derived layouts hide this with their own version.
+*/
+template<typename Key, typename Value, typename Derived>
+void NodeBase<Key, Value, Derived>::copyBalance(const Derived&)
+{
+
+}
+
+/*
+	-------------------------------------------
+	End implementations for the NodeBase class.
+	-------------------------------------------
+*/
+
+/*
+	-----------------------------------------
+	Begin implementations for the Node class.
+	-----------------------------------------
+*/
+
+/**
+* Explicit constructor for a node.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>::Node(const Key& key, const Value& value, Node<Key, Value>* parent) 
+	: NodeBase<Key, Value, Node<Key, Value> >(key, value, parent)
+	, mHeight(1)
+{ 
+
+} 
+
+/**
+* A const getter for the height.
+*/
+template<typename Key, typename Value>
+int Node<Key, Value>::getHeight() const
+{
+	return mHeight;
+}
+
 /**
 * A setter for the height of a node.
 */
@@ -201,6 +275,17 @@ void Node<Key, Value>::setHeight(int height)
 	mHeight = height;
 }
 
+/**
+* Recomputes the height from the heights of the children.
+*/
+template<typename Key, typename Value>
+void Node<Key, Value>::recompute() 
+{ 
+	int lh = (this->mLeft != NULL) ? this->mLeft->getHeight() : 0;
+	int rh = (this->mRight != NULL) ? this->mRight->getHeight() : 0;
+	mHeight = std::max(lh, rh) + 1;
+}
+
 /*
 	---------------------------------------
 	End implementations for the Node class.
@@ -208,59 +293,287 @@ void Node<Key, Value>::setHeight(int height)
 */
 
 /**
-* A templated unbalanced binary search tree.
+* Issues software prefetches for both children of a node, so that whichever way the comparison at the
+* node goes, the next node of a descent is already on its way into the cache. Define BST_NO_PREFETCH to
+* turn this off.
 */
-template <typename Key, typename Value>
+template <typename NodeType>
+inline void prefetchChildren(const NodeType* node)
+{
+#if !defined(BST_NO_PREFETCH) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_prefetch(node->getLeft());
+	__builtin_prefetch(node->getRight());
+#endif
+}
+
+//prefetches a single node, for descents that know which child they take before they need it
+template <typename NodeType>
+inline void prefetchNode(const NodeType* node)
+{
+#if !defined(BST_NO_PREFETCH) && (defined(__GNUC__) || defined(__clang__))
+	__builtin_prefetch(node);
+#endif
+}
+
+/**
+* Three-way comparison of two keys under a tree's Compare: negative if a goes before b, positive if it
+* goes after and 0 if they are equivalent. With an arbitrary Compare this takes one or two calls.
+*/
+template <typename Compare>
+struct KeyOrder
+{
+	template <typename A, typename B>
+	static int compare(const Compare& comp, const A& a, const B& b)
+	{
+		if(comp(a, b)) return -1;
+		if(comp(b, a)) return 1;
+		return 0;
+	}
+};
+
+#if defined(__cpp_impl_three_way_comparison) && defined(__cpp_lib_three_way_comparison)
+/**
+* With std::less the ordering is the keys' own operator<, so keys that also have operator<=> are
+* compared exactly once per call, which matters for strings and composite keys.
+*/
+template <typename Key>
+struct KeyOrder<std::less<Key> >
+{
+	template <typename A, typename B>
+	static int compare(const std::less<Key>& comp, const A& a, const B& b)
+	{
+		if constexpr(std::three_way_comparable_with<A, B>)
+		{
+			auto order = a <=> b;
+			if(order < 0) return -1;
+			if(order > 0) return 1;
+			return 0;
+		}
+		else
+		{
+			if(comp(a, b)) return -1;
+			if(comp(b, a)) return 1;
+			return 0;
+		}
+	}
+};
+#endif
+
+/**
+* Compares one search key against the nodes visited by a descent. The default compares against each
+* node's key under Compare; node layouts that cache something about their key can specialize it to look
+* at the cache first. A probe lives for one descent, so per-key work can be done once in the constructor.
+*/
+template <typename NodeType, typename K, typename Compare>
+class NodeProbe
+{
+public:
+	NodeProbe(const K& key, const Compare& comp)
+		: mKey(key)
+		, mCompare(comp)
+	{
+
+	}
+
+	int compare(const NodeType* node) const
+	{
+		return KeyOrder<Compare>::compare(mCompare, mKey, node->getKey());
+	}
+
+private:
+	const K& mKey;
+	const Compare& mCompare;
+};
+
+/**
+* Keeps whatever a node layout caches about its key up to date. The tree calls keyed on every node it
+* makes or gives a new key, and a splay calls refresh on the nodes it relinks; both are paths that write the tree anyway, so
+* a lookup that leaves the tree as it is only ever reads the cache. The default caches nothing.
+*/
+template <typename NodeType, typename Compare>
+struct NodeKeyCache
+{
+	static void keyed(NodeType*, Compare&)
+	{
+
+	}
+
+	static void refresh(NodeType*, const Compare&)
+	{
+
+	}
+};
+
+/**
+* A templated unbalanced binary search tree. Nodes are obtained from Alloc rebound to NodeType, so any
+* standard allocator works here, including SlabAllocator and std::pmr::polymorphic_allocator.
+*/
+template <typename Key, typename Value, typename NodeType = Node<Key, Value>, 
+	typename Alloc = std::allocator<std::pair<const Key, Value> >, typename Compare = std::less<Key> >
 class BinarySearchTree 
 {
 	public:
-		BinarySearchTree(); //TODO
+		typedef Alloc allocator_type;
+		typedef Compare key_compare;
+		class iterator;
+
+		explicit BinarySearchTree(const Alloc& alloc = Alloc()); //TODO
+		explicit BinarySearchTree(const Compare& comp, const Alloc& alloc = Alloc());
+		BinarySearchTree(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>& other);
+		BinarySearchTree<Key, Value, NodeType, Alloc, Compare>& operator=(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>& other);
 		virtual ~BinarySearchTree(); //TODO
 		int height(); //TODO 
+		int height_recursive(NodeType* node) const; //added helper
 		bool isBalanced(); //TODO 
-		bool isBalanced_recursive(Node<Key, Value>* node); //added helper
-		virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
+		bool isBalanced_recursive(NodeType* node); //added helper
+		virtual iterator insert(const std::pair<const Key, Value>& keyValuePair); //TODO
 		virtual void remove(const Key& key); //TODO
-		void clear(); //TODO
-		void clear_recursive(Node<Key, Value>* node); //added helper
+		virtual void clear(); //TODO
+		void clear_recursive(NodeType* node); //added helper
+		template <typename ForwardIt>
+		void assign(ForwardIt first, ForwardIt last);
+		template <typename ForwardIt>
+		void assignParallel(ForwardIt first, ForwardIt last, std::size_t threads = 0);
 		void print() const;
-		Node<Key, Value>* getRoot();
+		NodeType* getRoot();
+		Compare key_comp() const;
+		Alloc get_allocator() const;
 
 	public:
+		class const_iterator;
+
 		/**
-		* An internal iterator class for traversing the contents of the BST.
+		* An internal iterator class for traversing the contents of the BST. It is bidirectional and meets
+		* the requirements std::map's iterators do. An iterator remembers its tree, so the end iterator can
+		* be decremented to the largest item. Moving an iterator never restructures the tree, and splays do
+		* not invalidate iterators; only removing an item does, for the iterators to that item.
 		*/
 		class iterator 
 		{
 			public:
-				iterator(Node<Key,Value>* ptr);
+				typedef std::bidirectional_iterator_tag iterator_category;
+				typedef std::pair<const Key, Value> value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef std::pair<const Key, Value>* pointer;
+				typedef std::pair<const Key, Value>& reference;
+
+				iterator(NodeType* ptr, const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>* tree = nullptr);
 				iterator();
 
-				std::pair<const Key, Value>& operator*();
-				std::pair<const Key, Value>* operator->();
+				std::pair<const Key, Value>& operator*() const;
+				std::pair<const Key, Value>* operator->() const;
 
 				bool operator==(const iterator& rhs) const;
 				bool operator!=(const iterator& rhs) const;
-				iterator& operator=(const iterator& rhs);
+				bool operator==(const const_iterator& rhs) const;
+				bool operator!=(const const_iterator& rhs) const;
 
 				iterator& operator++();
+				iterator operator++(int);
+				iterator& operator--();
+				iterator operator--(int);
+
+			protected:
+				friend class BinarySearchTree<Key, Value, NodeType, Alloc, Compare>;
+				friend class const_iterator;
+				NodeType* mCurrent;
+				const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>* mTree;
+		};
+
+		/**
+		* The read-only counterpart of iterator, which converts to it implicitly.
+		*/
+		class const_iterator
+		{
+			public:
+				typedef std::bidirectional_iterator_tag iterator_category;
+				typedef std::pair<const Key, Value> value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const std::pair<const Key, Value>* pointer;
+				typedef const std::pair<const Key, Value>& reference;
+
+				const_iterator(const NodeType* ptr, const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>* tree = nullptr);
+				const_iterator(const iterator& it);
+				const_iterator();
+
+				const std::pair<const Key, Value>& operator*() const;
+				const std::pair<const Key, Value>* operator->() const;
+
+				bool operator==(const const_iterator& rhs) const;
+				bool operator!=(const const_iterator& rhs) const;
+
+				const_iterator& operator++();
+				const_iterator operator++(int);
+				const_iterator& operator--();
+				const_iterator operator--(int);
 
 			protected:
-				Node<Key, Value>* mCurrent;
+				friend class BinarySearchTree<Key, Value, NodeType, Alloc, Compare>;
+				const NodeType* mCurrent;
+				const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>* mTree;
 		};
 
+		typedef std::reverse_iterator<iterator> reverse_iterator;
+		typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
 	public:
 		iterator begin();
 		iterator end();
+		const_iterator begin() const;
+		const_iterator end() const;
+		const_iterator cbegin() const;
+		const_iterator cend() const;
+		reverse_iterator rbegin();
+		reverse_iterator rend();
+		const_reverse_iterator rbegin() const;
+		const_reverse_iterator rend() const;
 		iterator find(const Key& key) const;
+		template <typename K, typename C = Compare, typename = typename C::is_transparent>
+		iterator find(const K& key) const;
+		iterator lower_bound(const Key& key);
+		const_iterator lower_bound(const Key& key) const;
+		iterator upper_bound(const Key& key);
+		const_iterator upper_bound(const Key& key) const;
+		std::pair<iterator, iterator> equal_range(const Key& key);
+		std::pair<const_iterator, const_iterator> equal_range(const Key& key) const;
+		template <typename Callback>
+		void scan(const Key& lo, const Key& hi, Callback callback) const;
+		template <typename ForwardIt, typename OutputIt>
+		OutputIt multiFind(ForwardIt first, ForwardIt last, OutputIt out) const;
 
 	protected:
-		Node<Key, Value>* internalFind(const Key& key) const; //TODO
-		Node<Key, Value>* getSmallestNode() const; //TODO
-		void printRoot (Node<Key, Value>* root) const;
+		static const std::size_t MULTI_FIND_LANES = 16;
+
+		typedef typename std::allocator_traits<Alloc>::template rebind_alloc<NodeType> NodeAllocator;
+		typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+
+		static NodeType* nodeOf(const iterator& it);
+		NodeType* createNode(const Key& key, const Value& value, NodeType* parent);
+		NodeType* cloneNode(const NodeType* source, NodeType* parent);
+		NodeType* cloneTree(const NodeType* source);
+		template <typename ForwardIt>
+		NodeType* buildBalanced(ForwardIt& it, std::size_t n, NodeType* parent);
+		void buildFromSorted(std::vector<std::pair<Key, Value> >& items);
+		void destroyNode(NodeType* node);
+		template <typename A, typename B>
+		int compareKeys(const A& a, const B& b) const;
+		template <typename K>
+		NodeType* internalFind(const K& key) const; //TODO
+		template <typename ForwardIt, typename Visit>
+		void interleavedFind(ForwardIt first, ForwardIt last, Visit visit) const;
+		NodeType* lowerBoundNode(const Key& key) const;
+		NodeType* upperBoundNode(const Key& key) const;
+		static NodeType* successor(NodeType* node);
+		static NodeType* predecessor(NodeType* node);
+		NodeType* getSmallestNode() const; //TODO
+		NodeType* getLargestNode() const;
+		void recomputeUpward(NodeType* node);
+		void printRoot (NodeType* root) const;
 
 	protected:
-		Node<Key, Value>* mRoot;
+		NodeAllocator mAlloc;
+		Compare mCompare;
+		NodeType* mRoot;
 };
 
 /*
@@ -270,11 +583,13 @@ class BinarySearchTree
 */
 
 /**
-* Explicit constructor that initializes an iterator with a given node pointer.
+* Explicit constructor that initializes an iterator with a given node pointer. tree is only needed to
+* decrement the end iterator.
 */
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value>* ptr)
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::iterator(NodeType* ptr, const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>* tree)
 	: mCurrent(ptr)
+	, mTree(tree)
 { 
 
 }
@@ -282,9 +597,10 @@ BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value>* ptr)
 /**
 * A default constructor that initializes the iterator to NULL.
 */
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::iterator::iterator()
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::iterator()
 	: mCurrent(NULL)
+	, mTree(NULL)
 { 
 
 }
@@ -292,8 +608,8 @@ BinarySearchTree<Key, Value>::iterator::iterator()
 /**
 * Provides access to the item.
 */
-template<typename Key, typename Value>
-std::pair<const Key, Value>& BinarySearchTree<Key, Value>::iterator::operator*() 
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+std::pair<const Key, Value>& BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::operator*() const
 { 
 	return mCurrent->getItem();
 }
@@ -301,146 +617,427 @@ std::pair<const Key, Value>& BinarySearchTree<Key, Value>::iterator::operator*()
 /**
 * Provides access to the address of the item.
 */
-template<typename Key, typename Value>
-std::pair<const Key, Value>* BinarySearchTree<Key, Value>::iterator::operator->() 
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+std::pair<const Key, Value>* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::operator->() const
 { 
 	return &(mCurrent->getItem()); 
 }
 
-/**
-* Checks if 'this' iterator's internals have the same value
-* as 'rhs'
-*/
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::iterator::operator==(const BinarySearchTree<Key, Value>::iterator& rhs) const
+/**
+* Checks if 'this' iterator's internals have the same value
+* as 'rhs'
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+bool BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::operator==(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator& rhs) const
+{
+	return this->mCurrent == rhs.mCurrent;
+}
+
+/**
+* Checks if 'this' iterator's internals have a different value
+* as 'rhs'
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+bool BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::operator!=(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator& rhs) const
+{
+	return this->mCurrent != rhs.mCurrent;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+bool BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::operator==(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator& rhs) const
+{
+	return this->mCurrent == rhs.mCurrent;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+bool BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::operator!=(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator& rhs) const
+{
+	return this->mCurrent != rhs.mCurrent;
+}
+
+/**
+* Advances the iterator's location using an in-order traversal.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator& BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::operator++()
+{
+	mCurrent = successor(mCurrent);
+	return *this;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::operator++(int)
+{
+	iterator old(*this);
+	++*this;
+	return old;
+}
+
+/**
+* Moves the iterator back to the previous item in order; from the end iterator, to the largest item.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator& BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::operator--()
+{
+	if(mCurrent == NULL) mCurrent = mTree->getLargestNode();
+	else mCurrent = predecessor(mCurrent);
+	return *this;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator::operator--(int)
+{
+	iterator old(*this);
+	--*this;
+	return old;
+}
+
+/*
+	-------------------------------------------------------------
+	End implementations for the BinarySearchTree::iterator class.
+	-------------------------------------------------------------
+*/
+
+/*
+	---------------------------------------------------------------------
+	Begin implementations for the BinarySearchTree::const_iterator class.
+	---------------------------------------------------------------------
+*/
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::const_iterator(const NodeType* ptr, const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>* tree)
+	: mCurrent(ptr)
+	, mTree(tree)
+{
+
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::const_iterator(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator& it)
+	: mCurrent(it.mCurrent)
+	, mTree(it.mTree)
+{
+
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::const_iterator()
+	: mCurrent(NULL)
+	, mTree(NULL)
+{
+
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+const std::pair<const Key, Value>& BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::operator*() const
+{
+	return mCurrent->getItem();
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+const std::pair<const Key, Value>* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::operator->() const
+{
+	return &(mCurrent->getItem());
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+bool BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::operator==(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator& rhs) const
+{
+	return this->mCurrent == rhs.mCurrent;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+bool BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::operator!=(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator& rhs) const
+{
+	return this->mCurrent != rhs.mCurrent;
+}
+
+//the traversal helpers never write through the node, so casting the const away is safe
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator& BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::operator++()
+{
+	mCurrent = successor(const_cast<NodeType*>(mCurrent));
+	return *this;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::operator++(int)
+{
+	const_iterator old(*this);
+	++*this;
+	return old;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator& BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::operator--()
+{
+	if(mCurrent == NULL) mCurrent = mTree->getLargestNode();
+	else mCurrent = predecessor(const_cast<NodeType*>(mCurrent));
+	return *this;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator::operator--(int)
+{
+	const_iterator old(*this);
+	--*this;
+	return old;
+}
+
+/*
+	-------------------------------------------------------------------
+	End implementations for the BinarySearchTree::const_iterator class.
+	-------------------------------------------------------------------
+*/
+
+/*
+	-----------------------------------------------------
+	Begin implementations for the BinarySearchTree class.
+	-----------------------------------------------------
+*/
+
+/**
+* Default constructor for a BinarySearchTree, which sets the root to NULL.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::BinarySearchTree(const Alloc& alloc) 
+	: mAlloc(alloc)
+	, mCompare()
+{ 
+	// TODO
+	mRoot = nullptr;
+}
+
+/**
+* Constructor for a BinarySearchTree ordered by the given comparator.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::BinarySearchTree(const Compare& comp, const Alloc& alloc) 
+	: mAlloc(alloc)
+	, mCompare(comp)
+	, mRoot(nullptr)
+{ 
+
+}
+
+/**
+* Copy constructor. The copy has the same shape as other and is built in one O(n) walk (see cloneTree),
+* with no comparisons and no rebalancing.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::BinarySearchTree(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>& other)
+	: mAlloc(NodeAllocatorTraits::select_on_container_copy_construction(other.mAlloc))
+	, mCompare(other.mCompare)
+	, mRoot(nullptr)
+{
+	mRoot = cloneTree(other.mRoot);
+}
+
+/**
+* Copy assignment, O(n + m). The copy is made before the old nodes are freed, so if it throws the tree
+* keeps its contents. The tree keeps its own allocator.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+BinarySearchTree<Key, Value, NodeType, Alloc, Compare>& BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::operator=(const BinarySearchTree<Key, Value, NodeType, Alloc, Compare>& other)
+{
+	if(&other == this) return *this;
+	NodeType* copy = cloneTree(other.mRoot);
+	NodeType* old = mRoot;
+	mRoot = copy;
+	mCompare = other.mCompare;
+	//node by node, since releasing the allocator's chunks would take the copy with them
+	clear_recursive(old);
+	return *this;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::~BinarySearchTree() 
+{ 
+	// TODO
+	clear();
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::print() const
+{ 
+	printRoot(mRoot);
+	std::cout << "\n";
+}
+
+/**
+* Returns an iterator to the "smallest" item in the tree
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::begin()
+{
+	BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator begin(getSmallestNode(), this);
+	return begin;
+}
+
+/**
+* Returns an iterator whose value means INVALID
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::end()
+{
+	BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator end(NULL, this);
+	return end;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::begin() const
+{
+	return const_iterator(getSmallestNode(), this);
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::end() const
+{
+	return const_iterator(NULL, this);
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::cbegin() const
+{
+	return begin();
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::cend() const
+{
+	return end();
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::reverse_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::rbegin()
+{
+	return reverse_iterator(end());
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::reverse_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::rend()
+{
+	return reverse_iterator(begin());
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_reverse_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::rbegin() const
+{
+	return const_reverse_iterator(end());
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_reverse_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::rend() const
 {
-	return this->mCurrent == rhs.mCurrent;
+	return const_reverse_iterator(begin());
 }
 
 /**
-* Checks if 'this' iterator's internals have a different value
-* as 'rhs'
+* Returns an iterator to the item with the given key, k
+* or the end iterator if k does not exist in the tree
 */
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::iterator::operator!=(const BinarySearchTree<Key, Value>::iterator& rhs) const
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::find(const Key& key) const 
 {
-	return this->mCurrent != rhs.mCurrent;
+	NodeType* curr = internalFind(key);
+	BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator it(curr, this);
+	return it;
 }
 
 /**
-* Sets one iterator equal to another iterator.
+* Heterogeneous find, available when Compare is transparent (e.g. std::less<>), so that a key that
+* compares against Key can be looked up without building a temporary Key.
 */
-template<typename Key, typename Value>
-typename BinarySearchTree<Key, Value>::iterator &BinarySearchTree<Key, Value>::iterator::operator=(const BinarySearchTree<Key, Value>::iterator& rhs)
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::find(const K& key) const 
 {
-	this->mCurrent = rhs.mCurrent;
-	return *this;
+	return iterator(internalFind(key), this);
 }
 
 /**
-* Advances the iterator's location using an in-order traversal.
+* Returns an iterator to the first item whose key is not less than key, or the end iterator. Like every
+* bound below, this is a plain descent and does not restructure the tree, splay tree or not.
 */
-template<typename Key, typename Value>
-typename BinarySearchTree<Key, Value>::iterator& BinarySearchTree<Key, Value>::iterator::operator++()
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::lower_bound(const Key& key)
 {
-	if(mCurrent->getRight() != NULL)
-	{
-		mCurrent = mCurrent->getRight();
-		while(mCurrent->getLeft() != NULL)
-		{
-			mCurrent = mCurrent->getLeft();
-		}
-	}
-	else if(mCurrent->getRight() == NULL)
-	{
-		Node<Key, Value>* parent = mCurrent->getParent();
-		while(parent != NULL && mCurrent == parent->getRight())
-		{
-			mCurrent = parent;
-			parent = parent->getParent();
-		}
-		mCurrent = parent;
-	}
-	return *this;
+	return iterator(lowerBoundNode(key), this);
 }
 
-/*
-	-------------------------------------------------------------
-	End implementations for the BinarySearchTree::iterator class.
-	-------------------------------------------------------------
-*/
-
-/*
-	-----------------------------------------------------
-	Begin implementations for the BinarySearchTree class.
-	-----------------------------------------------------
-*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::lower_bound(const Key& key) const
+{
+	return const_iterator(lowerBoundNode(key), this);
+}
 
 /**
-* Default constructor for a BinarySearchTree, which sets the root to NULL.
+* Returns an iterator to the first item whose key is greater than key, or the end iterator.
 */
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::BinarySearchTree() 
-{ 
-	// TODO
-	mRoot = nullptr;
-}
-
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::~BinarySearchTree() 
-{ 
-	// TODO
-	clear();
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::upper_bound(const Key& key)
+{
+	return iterator(upperBoundNode(key), this);
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::print() const
-{ 
-	printRoot(mRoot);
-	std::cout << "\n";
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::upper_bound(const Key& key) const
+{
+	return const_iterator(upperBoundNode(key), this);
 }
 
 /**
-* Returns an iterator to the "smallest" item in the tree
+* Returns the range of items with the given key, which holds one item or none since keys are unique.
 */
-template<typename Key, typename Value>
-typename BinarySearchTree<Key, Value>::iterator BinarySearchTree<Key, Value>::begin()
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+std::pair<typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator, typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator> BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::equal_range(const Key& key)
 {
-	BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
-	return begin;
+	NodeType* lo = lowerBoundNode(key);
+	NodeType* hi = lo != NULL && compareKeys(key, lo->getKey()) == 0 ? successor(lo) : lo;
+	return std::make_pair(iterator(lo, this), iterator(hi, this));
 }
 
-/**
-* Returns an iterator whose value means INVALID
-*/
-template<typename Key, typename Value>
-typename BinarySearchTree<Key, Value>::iterator BinarySearchTree<Key, Value>::end()
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+std::pair<typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator, typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::const_iterator> BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::equal_range(const Key& key) const
 {
-	BinarySearchTree<Key, Value>::iterator end(NULL);
-	return end;
+	NodeType* lo = lowerBoundNode(key);
+	NodeType* hi = lo != NULL && compareKeys(key, lo->getKey()) == 0 ? successor(lo) : lo;
+	return std::make_pair(const_iterator(lo, this), const_iterator(hi, this));
 }
 
 /**
-* Returns an iterator to the item with the given key, k
-* or the end iterator if k does not exist in the tree
+* Calls callback with every item whose key k has lo <= k < hi, in key order, the same range
+* SplayTree::eraseRange uses. One descent finds lo and the rest is an in-order walk over the parent
+* links, so the cost is O(log n) plus the number of items and the tree is left exactly as it was. The
+* callback must not insert or remove items.
 */
-template<typename Key, typename Value>
-typename BinarySearchTree<Key, Value>::iterator BinarySearchTree<Key, Value>::find(const Key& key) const 
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template<typename Callback>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::scan(const Key& lo, const Key& hi, Callback callback) const
 {
-	Node<Key, Value>* curr = internalFind(key);
-	BinarySearchTree<Key, Value>::iterator it(curr);
-	return it;
+	for(NodeType* node = lowerBoundNode(lo); node != NULL && compareKeys(node->getKey(), hi) < 0; node = successor(node))
+	{
+		const NodeType* item = node;
+		callback(item->getItem());
+	}
 }
 
 /**
-* An method to return the height of the BST.
+* An method to return the height of the BST. The height is computed from the structure rather than
+* read from the root, since not every node layout stores one.
 */
-template<typename Key, typename Value>
-int BinarySearchTree<Key, Value>::height()
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+int BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::height()
 {
 	// TODO
-	if(mRoot != nullptr) return mRoot->getHeight();
-	return 0;
+	return height_recursive(mRoot);
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+int BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::height_recursive(NodeType* node) const
+{
+	if(node == nullptr) return 0;
+	return std::max(height_recursive(node->getLeft()), height_recursive(node->getRight())) + 1;
 }
 
 
@@ -448,8 +1045,8 @@ int BinarySearchTree<Key, Value>::height()
 * An method to checks if the BST is balanced. This method returns true if and only if the BST is balanced.
 */
 
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalanced_recursive(Node<Key, Value>* node)
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+bool BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::isBalanced_recursive(NodeType* node)
 {
 	// TODO
 	//always true if root is NULL
@@ -459,7 +1056,7 @@ bool BinarySearchTree<Key, Value>::isBalanced_recursive(Node<Key, Value>* node)
 	//CHECK LEFT AND RIGHT 
 	//root
 	if(node == nullptr) return true;
-	if(node->getRight() != nullptr) rh = node->getRight()->getHeight();
+	if(node->getRight() != nullptr) rh = height_recursive(node->getRight());
 	else rh = 0;
 	//right height and left height
 	bool left_balanced = isBalanced_recursive(node->getLeft());
@@ -468,90 +1065,77 @@ bool BinarySearchTree<Key, Value>::isBalanced_recursive(Node<Key, Value>* node)
 	if(right_balanced == false) return false;
 
 	//if node left is not NULL
-	if(node->getLeft() != nullptr) lh = node->getLeft()->getHeight();
+	if(node->getLeft() != nullptr) lh = height_recursive(node->getLeft());
 	else lh = 0;
 	if(lh - rh < 2 && lh-rh > -2) return true;
 	else return false;
 }
 
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalanced()
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+bool BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::isBalanced()
 {
 	return isBalanced_recursive(mRoot);
 }
 
 /**
 * An insert method to insert into a Binary Search Tree. The tree will not remain balanced when 
-* inserting.
+* inserting. Returns an iterator to the inserted (or overwritten) item.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::iterator BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
 {	
 	// TODO
 	if(mRoot == nullptr)
 	{
 		//creating a new node with initalized values 
-		Node<Key, Value> *new_node = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, nullptr);
+		NodeType *new_node = createNode(keyValuePair.first, keyValuePair.second, nullptr);
 		//initialize right, left, and parent to NULL
-		//make sure to set hte height to 1
 		new_node->setRight(nullptr);
 		new_node->setLeft(nullptr);
 		//root
-		new_node->setHeight(1);
 		new_node->setParent(nullptr);
 		mRoot = new_node;
 		//end
-		return;
+		return iterator(new_node, this);
 	}
-	else if(mRoot != nullptr)
+	else
 	{
 		//set curr to Root 
-		Node<Key, Value>* curr = mRoot;
-		//setting new node
-		Node<Key, Value> *new_node = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, nullptr);
+		NodeType* curr = mRoot;
 		//until curr's key does not equal the key 
-		while(curr->getKey() != keyValuePair.first)
+		int c;
+		while((c = compareKeys(keyValuePair.first, curr->getKey())) != 0)
 		{
-	 		if(keyValuePair.first < curr->getKey())
+	 		if(c < 0)
 	 		{
 	 			//if left is valid, move down left 
 	 			if(!curr->getLeft()) 
 	 			{
-	 				//setting height if not valid 
-	 				new_node->setHeight(1);
-
-	 				//set left as new node
-	 				curr->setLeft(new_node);
-	 				new_node->setParent(curr);
-	 				//the new node's left and right will now be NULL
-	 				new_node->setLeft(nullptr);
-	 				new_node->setRight(nullptr);
-	 				break;
+	 				//set left as new node, its left and right start out NULL
+	 				curr->setLeft(createNode(keyValuePair.first, keyValuePair.second, curr));
+	 				recomputeUpward(curr);
+	 				return iterator(curr->getLeft(), this);
 	 			}
 	 			else curr = curr->getLeft();
 
 	 		}
 	 		//second comparison get right 
-	 		else if(keyValuePair.first > curr->getKey())
+	 		else
 	 		{
 	 			if(!curr->getRight())
 	 			{
-	 				//if not valid, set nodes
-	 				curr->setRight(new_node);
-
-	 				//height always becomes NULL
-	 				new_node->setHeight(1);
-	 				new_node->setParent(curr);
-
-	 				//make sure to set lefts and rights to NULL
-	 				new_node->setLeft(nullptr);
-	 				new_node->setRight(nullptr);
-	 				break;
-	 				//set parent to curr
+	 				//set right as new node, its left and right start out NULL
+	 				curr->setRight(createNode(keyValuePair.first, keyValuePair.second, curr));
+	 				recomputeUpward(curr);
+	 				return iterator(curr->getRight(), this);
 	 			}
 	 			else curr = curr->getRight();
 	 		}
 		}
+		//key already in the tree, overwrite the value
+		curr->setValue(keyValuePair.second);
+		recomputeUpward(curr);
+		return iterator(curr, this);
 	}
 }
 
@@ -559,19 +1143,19 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value>& key
 * An remove method to remove a specific key from a Binary Search Tree. The tree may not remain balanced after
 * removal.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::remove(const Key& key)
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::remove(const Key& key)
 {
 	//internal find store into curr
-	Node<Key, Value>* curr = internalFind(key);
+	NodeType* curr = internalFind(key);
 	//set prev and child as null
-	Node<Key, Value>* prev = nullptr;
-	Node<Key, Value>* child = nullptr;
+	NodeType* prev = nullptr;
+	NodeType* child = nullptr;
 	if(curr->getLeft() == nullptr && curr->getRight() == nullptr) {
 		//curr only node case 
 		if(curr->getParent() == nullptr) 
 			{
-				delete curr;
+				destroyNode(curr);
 				mRoot = nullptr;
 			}
 		else
@@ -579,21 +1163,18 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 			prev = curr->getParent();
 			if(curr == prev->getLeft()) prev->setLeft(nullptr);
 			else prev->setRight(nullptr);
-			delete curr;
+			destroyNode(curr);
 		}
 		while(prev != nullptr) {
-			if(prev->getLeft() == nullptr && prev->getRight() == nullptr) prev->setHeight(prev->getHeight()-1);
-			else if(prev->getLeft() == nullptr) prev->setHeight(prev->getRight()->getHeight() + 1);
-			else if(prev->getRight() == nullptr) prev->setHeight(prev->getLeft()->getHeight() + 1);
-			else prev->setHeight(std::max(prev->getRight()->getHeight(), prev->getLeft()->getHeight()) + 1);
+			prev->recompute();
 			prev = prev->getParent();
 		}
 	}
 	else if(curr->getRight() == nullptr && curr->getLeft() != nullptr) {
 		if(curr->getParent() == nullptr) 
 		{
-			Node<Key, Value>* temp = curr->getLeft();
-			delete curr;
+			NodeType* temp = curr->getLeft();
+			destroyNode(curr);
 			mRoot = temp;
 			temp->setParent(nullptr);
 		}
@@ -609,21 +1190,18 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 				prev->setRight(child);
 				child->setParent(prev);
 			}
-			delete curr;
+			destroyNode(curr);
 		}
 		while(prev != nullptr) {
-			if(prev->getLeft() == nullptr && prev->getRight() == nullptr) prev->setHeight(prev->getHeight()-1);
-			else if(prev->getLeft() == nullptr) prev->setHeight(prev->getRight()->getHeight() + 1);
-			else if(prev->getRight() == nullptr) prev->setHeight(prev->getLeft()->getHeight() + 1);
-			else prev->setHeight(std::max(prev->getRight()->getHeight(), prev->getLeft()->getHeight()) + 1);
+			prev->recompute();
 			prev = prev->getParent();
 		}
 	}
 	else if(curr->getRight() != nullptr && curr->getLeft() == nullptr) {
 		if(curr->getParent() == nullptr) 
 		{
-			Node<Key, Value>* temp = curr->getRight();
-			delete curr;
+			NodeType* temp = curr->getRight();
+			destroyNode(curr);
 			mRoot = temp;
 			temp->setParent(nullptr);
 		}
@@ -639,18 +1217,15 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 				prev->setRight(child);
 				child->setParent(prev);
 			}
-			delete curr;
+			destroyNode(curr);
 		}
 		while(prev != nullptr) {
-			if(prev->getLeft() == nullptr && prev->getRight() == nullptr) prev->setHeight(prev->getHeight()-1);
-			else if(prev->getLeft() == nullptr) prev->setHeight(prev->getRight()->getHeight() + 1);
-			else if(prev->getRight() == nullptr) prev->setHeight(prev->getLeft()->getHeight() + 1);
-			else prev->setHeight(std::max(prev->getRight()->getHeight(), prev->getLeft()->getHeight()) + 1);
+			prev->recompute();
 			prev = prev->getParent();
 		}
 	}
 	else {
-		Node<Key, Value>* pred = curr->getLeft();
+		NodeType* pred = curr->getLeft();
 		if(pred->getRight() != nullptr) {
 			while(pred->getRight() != nullptr) {
 				pred = pred->getRight();
@@ -673,7 +1248,7 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 
 				curr->getLeft()->setParent(pred);
 				curr->getRight()->setParent(pred);
-				delete curr;
+				destroyNode(curr);
 			}
 			else {
 				//added these two lines for the child
@@ -695,13 +1270,10 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 
 				curr->getLeft()->setParent(pred);
 				curr->getRight()->setParent(pred);
-				delete curr;
+				destroyNode(curr);
 			}
 			while(prev != nullptr) {
-				if(prev->getLeft() == nullptr && prev->getRight() == nullptr) prev->setHeight(prev->getHeight()-1);
-				else if(prev->getLeft() == nullptr) prev->setHeight(prev->getRight()->getHeight() + 1);
-				else if(prev->getRight() == nullptr) prev->setHeight(prev->getLeft()->getHeight() + 1);
-				else prev->setHeight(std::max(prev->getRight()->getHeight(), prev->getLeft()->getHeight()) + 1);
+				prev->recompute();
 				prev = prev->getParent();
 			}
 		}
@@ -717,51 +1289,275 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 				this->mRoot = pred;
 			}
 			curr->getRight()->setParent(pred);
-			delete curr;
+			destroyNode(curr);
 
 			while(pred != nullptr) {
-				if(pred->getLeft() == nullptr && pred->getRight() == nullptr) pred->setHeight(pred->getHeight()-1);
-				else if(pred->getLeft() == nullptr) pred->setHeight(pred->getRight()->getHeight() + 1);
-				else if(pred->getRight() == nullptr) pred->setHeight(pred->getLeft()->getHeight() + 1);
-				else pred->setHeight(std::max(pred->getRight()->getHeight(), pred->getLeft()->getHeight()) + 1);
+				pred->recompute();
 				pred = pred->getParent();
 			}
 		}
 	}
 }
 
+/**
+* Destroys the subtree at node in O(n) without recursion or a stack, however deep it is. Whenever the top
+* node has a left child it is rotated right, which reverses that one link; once the top has no left child
+* it is the smallest node left and is freed, and its right subtree carries on. A rotation takes a left
+* link out for good, so there are fewer than n of them. Parent links are not kept up to date.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::clear_recursive(NodeType* node)
+{
+	while(node != nullptr)
+	{
+		NodeType* left = node->getLeft();
+		if(left != nullptr)
+		{
+			node->setLeft(left->getRight());
+			left->setRight(node);
+			node = left;
+		}
+		else
+		{
+			NodeType* right = node->getRight();
+			destroyNode(node);
+			node = right;
+		}
+	}
+}
+
 /**
 * A method to remove all contents of the tree and reset the values in the tree 
 * for use again.
 */
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::clear()
+{
+	//nodes with nothing to destroy can go back to a slab allocator a chunk at a time
+	if(mRoot != nullptr && std::is_trivially_destructible<NodeType>::value 
+		&& AllocatorRelease<NodeAllocator>::release(mAlloc))
+	{
+		mRoot = nullptr;
+		return;
+	}
+	clear_recursive(mRoot);
+	mRoot = nullptr;
+}
+
+/**
+* Replaces the contents of the tree with the key/value pairs in [first, last) and builds a perfectly
+* balanced tree from them in O(n), one node allocation per key and no comparisons beyond a check that
+* the input is strictly increasing. Input that is not is copied, sorted and stripped of duplicate keys
+* first (the last value of a key wins, as with insert), which costs O(n log n).
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template<typename ForwardIt>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::assign(ForwardIt first, ForwardIt last)
+{
+	clear();
+	std::size_t n = 0;
+	bool sorted = true;
+	for(ForwardIt prev = first, it = first; it != last; prev = it++, n++)
+	{
+		if(n > 0 && compareKeys(prev->first, it->first) >= 0) sorted = false;
+	}
+	if(sorted)
+	{
+		mRoot = buildBalanced(first, n, nullptr);
+		return;
+	}
+	typedef std::pair<Key, Value> Item;
+	std::vector<Item> items(first, last);
+	const Compare& comp = mCompare;
+	std::stable_sort(items.begin(), items.end(), [&comp](const Item& a, const Item& b) {
+		return comp(a.first, b.first);
+	});
+	buildFromSorted(items);
+}
 
-//easier to do vs. iterative 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clear_recursive(Node<Key, Value>* node)
+/**
+* Does what assign does for unsorted input, with the sort spread over threads (0 means the hardware
+* concurrency) by parallelStableSort. The tree itself is then built on the calling thread, since the
+* allocator need not be thread-safe.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template<typename ForwardIt>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::assignParallel(ForwardIt first, ForwardIt last, std::size_t threads)
 {
-	if(node != NULL)
+	clear();
+	typedef std::pair<Key, Value> Item;
+	std::vector<Item> items(first, last);
+	const Compare& comp = mCompare;
+	parallelStableSort(items.begin(), items.end(), [&comp](const Item& a, const Item& b) {
+		return comp(a.first, b.first);
+	}, forkDepth(threads));
+	buildFromSorted(items);
+}
+
+/**
+* Builds the tree, which must be empty, from items stably sorted by key. Runs of equal keys collapse onto
+* their last value, as if the items had been inserted in order.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::buildFromSorted(std::vector<std::pair<Key, Value> >& items)
+{
+	std::size_t unique = 0;
+	for(std::size_t i = 0; i < items.size(); i++)
 	{
-		clear_recursive(node->getRight());
-		clear_recursive(node->getLeft());
-		delete node;
+		if(unique > 0 && compareKeys(items[unique - 1].first, items[i].first) == 0) items[unique - 1].second = items[i].second;
+		else items[unique++] = items[i];
 	}
+	typename std::vector<std::pair<Key, Value> >::const_iterator it = items.begin();
+	mRoot = buildBalanced(it, unique, nullptr);
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clear()
+/**
+* Builds a perfectly balanced subtree from the next n items of a strictly increasing sequence and
+* advances it past them. The middle item becomes the root, so the depth is at most log2(n) + 1. Nodes
+* already built are freed again if an allocation or a copy throws.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template<typename ForwardIt>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::buildBalanced(ForwardIt& it, std::size_t n, NodeType* parent)
 {
-	//call rescursive implementation
-	clear_recursive(mRoot);
-	mRoot = nullptr;
+	if(n == 0) return nullptr;
+	std::size_t leftCount = n / 2;
+	NodeType* left = buildBalanced(it, leftCount, nullptr);
+	NodeType* node;
+	try
+	{
+		node = createNode(it->first, it->second, parent);
+	}
+	catch(...)
+	{
+		clear_recursive(left);
+		throw;
+	}
+	++it;
+	NodeType* right;
+	try
+	{
+		right = buildBalanced(it, n - leftCount - 1, node);
+	}
+	catch(...)
+	{
+		clear_recursive(left);
+		destroyNode(node);
+		throw;
+	}
+	node->setLeft(left);
+	if(left != nullptr) left->setParent(node);
+	node->setRight(right);
+	node->recompute();
+	return node;
+}
+
+//the node an iterator points at, so derived trees can start work from an iterator
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::nodeOf(const iterator& it)
+{
+	return it.mCurrent;
+}
+
+/**
+* Allocates and constructs a node through the tree's allocator, and fills in its key cache.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::createNode(const Key& key, const Value& value, NodeType* parent)
+{
+	NodeType* node = NodeAllocatorTraits::allocate(mAlloc, 1);
+	try
+	{
+		NodeAllocatorTraits::construct(mAlloc, node, key, value, parent);
+	}
+	catch(...)
+	{
+		NodeAllocatorTraits::deallocate(mAlloc, node, 1);
+		throw;
+	}
+	try
+	{
+		NodeKeyCache<NodeType, Compare>::keyed(node, mCompare);
+	}
+	catch(...)
+	{
+		destroyNode(node);
+		throw;
+	}
+	return node;
+}
+
+//a new node with source's item and balancing state, not yet linked to any children
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::cloneNode(const NodeType* source, NodeType* parent)
+{
+	NodeType* node = createNode(source->getKey(), source->getValue(), parent);
+	node->copyBalance(*source);
+	return node;
+}
+
+/**
+* Copies the subtree at source, shape and all, and returns the copy's root. The walk goes down and back
+* up through the parent links instead of recursing, so deep trees are fine, and each copied node has its
+* cached data recomputed on the way back up, once both of its children exist. O(n). If a copy throws,
+* the nodes made so far are freed.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::cloneTree(const NodeType* source)
+{
+	if(source == nullptr) return nullptr;
+	NodeType* root = cloneNode(source, nullptr);
+	const NodeType* from = source;
+	NodeType* to = root;
+	try
+	{
+		while(to != nullptr)
+		{
+			if(from->getLeft() != nullptr && to->getLeft() == nullptr)
+			{
+				to->setLeft(cloneNode(from->getLeft(), to));
+				from = from->getLeft();
+				to = to->getLeft();
+			}
+			else if(from->getRight() != nullptr && to->getRight() == nullptr)
+			{
+				to->setRight(cloneNode(from->getRight(), to));
+				from = from->getRight();
+				to = to->getRight();
+			}
+			else
+			{
+				to->recompute();
+				from = from->getParent();
+				to = to->getParent();
+			}
+		}
+	}
+	catch(...)
+	{
+		clear_recursive(root);
+		throw;
+	}
+	return root;
+}
+
+/**
+* Destroys a node and hands its memory back to the tree's allocator.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::destroyNode(NodeType* node)
+{
+	NodeAllocatorTraits::destroy(mAlloc, node);
+	NodeAllocatorTraits::deallocate(mAlloc, node, 1);
 }
 
 /**
 * A helper function to find the smallest node in the tree.
 */
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::getSmallestNode() const
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::getSmallestNode() const
 {
-	Node<Key, Value>* temp = mRoot;
+	NodeType* temp = mRoot;
 	if(mRoot != NULL)
 	{
 		while(temp->getLeft() != NULL)
@@ -772,32 +1568,222 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::getSmallestNode() const
 	return temp;
 }
 
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::getLargestNode() const
+{
+	NodeType* temp = mRoot;
+	if(temp != NULL)
+	{
+		while(temp->getRight() != NULL) temp = temp->getRight();
+	}
+	return temp;
+}
+
+//the first node whose key is not less than key
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::lowerBoundNode(const Key& key) const
+{
+	NodeType* bound = NULL;
+	NodeType* curr = mRoot;
+	while(curr != NULL)
+	{
+		prefetchChildren(curr);
+		if(compareKeys(curr->getKey(), key) < 0) curr = curr->getRight();
+		else
+		{
+			bound = curr;
+			curr = curr->getLeft();
+		}
+	}
+	return bound;
+}
+
+//the first node whose key is greater than key
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::upperBoundNode(const Key& key) const
+{
+	NodeType* bound = NULL;
+	NodeType* curr = mRoot;
+	while(curr != NULL)
+	{
+		prefetchChildren(curr);
+		if(compareKeys(key, curr->getKey()) < 0)
+		{
+			bound = curr;
+			curr = curr->getLeft();
+		}
+		else curr = curr->getRight();
+	}
+	return bound;
+}
+
+/**
+* The in-order successor of node, or NULL for the largest node.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::successor(NodeType* node)
+{
+	if(node->getRight() != NULL)
+	{
+		node = node->getRight();
+		while(node->getLeft() != NULL)
+		{
+			node = node->getLeft();
+		}
+		return node;
+	}
+	NodeType* parent = node->getParent();
+	while(parent != NULL && node == parent->getRight())
+	{
+		node = parent;
+		parent = parent->getParent();
+	}
+	return parent;
+}
+
+/**
+* The in-order predecessor of node, or NULL for the smallest node.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::predecessor(NodeType* node)
+{
+	if(node->getLeft() != NULL)
+	{
+		node = node->getLeft();
+		while(node->getRight() != NULL)
+		{
+			node = node->getRight();
+		}
+		return node;
+	}
+	NodeType* parent = node->getParent();
+	while(parent != NULL && node == parent->getLeft())
+	{
+		node = parent;
+		parent = parent->getParent();
+	}
+	return parent;
+}
+
+/**
+* Brings the cached data of node and all its ancestors up to date after the links below node changed.
+* Nodes that cache nothing skip the walk entirely.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::recomputeUpward(NodeType* node)
+{
+	if(!NodeType::AUGMENTED) return;
+	while(node != nullptr)
+	{
+		node->recompute();
+		node = node->getParent();
+	}
+}
+
+/**
+* Looks up every key in [first, last) and writes one iterator per key to out, the end iterator for keys
+* that are missing. Returns out advanced past the results. Unlike a loop of find, the lookups are run
+* interleaved (see interleavedFind), so their cache misses overlap. The tree is not modified.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template<typename ForwardIt, typename OutputIt>
+OutputIt BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::multiFind(ForwardIt first, ForwardIt last, OutputIt out) const
+{
+	interleavedFind(first, last, [this, &out](NodeType* node) {
+		*out = iterator(node, this);
+		++out;
+	});
+	return out;
+}
+
+/**
+* Runs the lookups of [first, last) in groups of MULTI_FIND_LANES descents that advance in lockstep. Each
+* step of a descent prefetches the child it moves to and then yields to the other lanes, so by the time
+* it comes round again the node is usually in cache and one thread keeps many misses in flight instead
+* of one (asynchronous memory access chaining). Once a group is done, visit is called with the node of
+* each key, or nullptr, in input order; the tree may be restructured from visit since no descent of the
+* group is still under way.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template<typename ForwardIt, typename Visit>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::interleavedFind(ForwardIt first, ForwardIt last, Visit visit) const
+{
+	ForwardIt keys[MULTI_FIND_LANES];
+	NodeType* curr[MULTI_FIND_LANES];
+	NodeType* found[MULTI_FIND_LANES];
+	while(first != last)
+	{
+		std::size_t lanes = 0;
+		for(; lanes < MULTI_FIND_LANES && first != last; ++first, lanes++)
+		{
+			keys[lanes] = first;
+			curr[lanes] = mRoot;
+			found[lanes] = nullptr;
+		}
+		//on an empty tree no lane has a step to take
+		std::size_t active = mRoot != nullptr ? lanes : 0;
+		while(active > 0)
+		{
+			for(std::size_t i = 0; i < lanes; i++)
+			{
+				NodeType* node = curr[i];
+				if(node == nullptr) continue;
+				int c = compareKeys(*keys[i], node->getKey());
+				NodeType* next = nullptr;
+				if(c == 0) found[i] = node;
+				else
+				{
+					next = c < 0 ? node->getLeft() : node->getRight();
+					if(next != nullptr) prefetchNode(next);
+				}
+				curr[i] = next;
+				if(next == nullptr) active--;
+			}
+		}
+		for(std::size_t i = 0; i < lanes; i++) visit(found[i]);
+	}
+}
+
 /**
 * Helper function to find a node with given key, k and 
 * return a pointer to it or NULL if no item with that key
 * exists
 */
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const 
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template<typename K>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::internalFind(const K& key) const 
 {
 	// TODO
-	Node<Key, Value>* current_node = mRoot;
+	NodeType* current_node = mRoot;
+	NodeProbe<NodeType, K, Compare> probe(key, mCompare);
 	//at current 
 	while(current_node)
 	{
-		if(key > current_node->getKey()) current_node = current_node->getRight();
-		else if(key < current_node->getKey()) current_node = current_node->getLeft();
+		prefetchChildren(current_node);
+		int c = probe.compare(current_node);
+		if(c > 0) current_node = current_node->getRight();
+		else if(c < 0) current_node = current_node->getLeft();
 		//if equal
 		else return current_node;
 	}
 	return nullptr;
 }
 
+/**
+* Compares two keys under the tree's comparator, see KeyOrder.
+*/
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template<typename A, typename B>
+int BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::compareKeys(const A& a, const B& b) const 
+{
+	return KeyOrder<Compare>::compare(mCompare, a, b);
+}
+
 /**
 * Helper function to print the tree's contents
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::printRoot (NodeType* root) const
 {
 	if (root != NULL)
 	{
@@ -810,12 +1796,24 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
 }
 
 
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::getRoot()
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::getRoot()
 {
 	return mRoot;
 }
 
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+Compare BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::key_comp() const
+{
+	return mCompare;
+}
+
+template<typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+Alloc BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::get_allocator() const
+{
+	return Alloc(mAlloc);
+}
+
 
 /*
 	---------------------------------------------------
@@ -3,64 +3,453 @@
 
 #include <iostream>
 #include "splayTree.h"
+#include "bSplayTree.h"
 #include <stdexcept>
 #include <cstdlib>
+#include <vector>
 
-template <typename Key, typename Value>
-class cacheLRU 
+/**
+* The tree type Tree with its values replaced by Mapped, the way allocators rebind: the node layout and
+* the allocator follow. There are versions for trees whose node layout takes the key and the value
+* (SplayTree, AVLTree, RedBlackTree, Treap and their node variants), for layouts that take only the
+* value (StringKeyNode), and for BSplayTree.
+*/
+template <typename Tree, typename Mapped>
+struct RebindTree;
+
+template <template <typename, typename, typename, typename, typename> class T, template <typename, typename> class N,
+	typename Key, typename Value, typename Alloc, typename Compare, typename Mapped>
+struct RebindTree<T<Key, Value, N<Key, Value>, Alloc, Compare>, Mapped>
+{
+	typedef T<Key, Mapped, N<Key, Mapped>,
+		typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const Key, Mapped> >, Compare> type;
+};
+
+template <template <typename, typename, typename, typename, typename> class T, template <typename> class N,
+	typename Key, typename Value, typename Alloc, typename Compare, typename Mapped>
+struct RebindTree<T<Key, Value, N<Value>, Alloc, Compare>, Mapped>
+{
+	typedef T<Key, Mapped, N<Mapped>,
+		typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const Key, Mapped> >, Compare> type;
+};
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity, typename Mapped>
+struct RebindTree<BSplayTree<Key, Value, Alloc, Compare, Capacity>, Mapped>
+{
+	typedef BSplayTree<Key, Mapped,
+		typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const Key, Mapped> >, Compare, Capacity> type;
+};
+
+/**
+* Whether Tree keeps each item at the same address for as long as it is in the tree. Node-based trees do;
+* BSplayTree does not, since its fat nodes shift items around as keys come and go.
+*/
+template <typename Tree>
+struct StableItems
+{
+	static const bool value = true;
+};
+
+template <typename Key, typename Value, typename Alloc, typename Compare, std::size_t Capacity>
+struct StableItems<BSplayTree<Key, Value, Alloc, Compare, Capacity> >
+{
+	static const bool value = false;
+};
+
+/**
+* A fixed-capacity key/value cache that evicts the least recently used entry. Tree is the search tree
+* holding the entries; it defaults to a SplayTree, and AVLTree, RedBlackTree or Treap can be used instead
+* when worst-case lookup time matters more than adapting to the access pattern, and BSplayTree when the
+* cache is large. Tree must offer insert, remove, find, end and the same constructors as SplayTree, and
+* is given to RebindTree, since it actually stores each value together with its recency links.
+*
+* Recency is a doubly-linked list threaded through those entries, newest first. get and put move the
+* entry they touch to the front in O(1), and the victim of an eviction is always the back of the list.
+* The links must not move, so with a Tree whose items do (see StableItems) each entry is allocated on its
+* own and the tree holds a pointer to it; otherwise the entry is the tree's value, and insert must
+* return an iterator to the item.
+*/
+template <typename Key, typename Value, typename Alloc = std::allocator<std::pair<const Key, Value> >,
+	typename Compare = std::less<Key>, typename Tree = SplayTree<Key, Value, SplayNode<Key, Value>, Alloc, Compare> >
+class cacheLRU
 {
 public:
-	cacheLRU(int capacity);
+	explicit cacheLRU(int capacity, const Alloc& alloc = Alloc());
+	cacheLRU(int capacity, const Compare& comp, const Alloc& alloc = Alloc());
 	~cacheLRU();
 	void put(const std::pair<const Key, Value>& keyValuePair);
 	std::pair<const Key, Value> get(const Key& key);
-//setting size, max_capacity, declaring splay tree 
+	template <typename ForwardIt>
+	void putMany(ForwardIt first, ForwardIt last);
+	template <typename InputIt, typename OutputIt>
+	std::size_t getMany(InputIt first, InputIt last, OutputIt out);
 private:
+	//a cached value and its place in the recency list; key points at the key stored next to it in the tree
+	struct Entry
+	{
+		explicit Entry(const Value& value);
+
+		Value value;
+		Entry* newer;
+		Entry* older;
+		const Key* key;
+	};
+	//an entry kept out of the tree, which needs its own copy of the key
+	struct OwnedEntry : Entry
+	{
+		OwnedEntry(const Key& key, const Value& value);
+
+		Key ownKey;
+	};
+	typedef std::integral_constant<bool, StableItems<Tree>::value> StableTag;
+	typedef typename std::conditional<StableItems<Tree>::value, Entry, OwnedEntry*>::type Stored;
+	typedef typename RebindTree<Tree, Stored>::type EntryTree;
+	typedef typename std::allocator_traits<typename EntryTree::allocator_type>::template rebind_alloc<OwnedEntry> EntryAllocator;
+	typedef std::allocator_traits<EntryAllocator> EntryAllocatorTraits;
+
+	cacheLRU(const cacheLRU& other);
+	cacheLRU& operator=(const cacheLRU& other);
+	void linkNewest(Entry* entry);
+	void unlink(Entry* entry);
+	void touch(Entry* entry);
+	void evictOldest();
+	Entry* insertEntry(const Key& key, const Value& value, std::true_type);
+	Entry* insertEntry(const Key& key, const Value& value, std::false_type);
+	Entry makeStored(const Key& key, const Value& value, std::true_type);
+	OwnedEntry* makeStored(const Key& key, const Value& value, std::false_type);
+	void destroyEntry(Entry* entry, std::true_type);
+	void destroyEntry(Entry* entry, std::false_type);
+	static Entry* storedEntry(Entry& stored);
+	static Entry* storedEntry(OwnedEntry* stored);
+	static Entry* entryOf(std::pair<const Key, Entry>& item);
+	static Entry* entryOf(std::pair<const Key, OwnedEntry*>& item);
+
+//setting size, max_capacity, declaring splay tree
 	int size;
 	int max_capacity;
-	SplayTree<Key, Value>* cache_splay;
+	EntryTree* cache_splay;
+	Entry* newest;
+	Entry* oldest;
 };
 
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+cacheLRU<Key, Value, Alloc, Compare, Tree>::Entry::Entry(const Value& value)
+	: value(value)
+	, newer(nullptr)
+	, older(nullptr)
+	, key(nullptr)
+{
+
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+cacheLRU<Key, Value, Alloc, Compare, Tree>::OwnedEntry::OwnedEntry(const Key& key, const Value& value)
+	: Entry(value)
+	, ownKey(key)
+{
+	this->key = &ownKey;
+}
+
 //constructor
-template <typename Key, typename Value>
-cacheLRU<Key, Value>::cacheLRU(int capacity)
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+cacheLRU<Key, Value, Alloc, Compare, Tree>::cacheLRU(int capacity, const Alloc& alloc)
 {
-	cache_splay = new SplayTree<Key, Value>();
+	cache_splay = new EntryTree(typename EntryTree::allocator_type(alloc));
 	//set max = capacity
 	max_capacity = capacity;
 	size = 0;
+	newest = nullptr;
+	oldest = nullptr;
 }
 
-//destructor 
-template <typename Key, typename Value>
-cacheLRU<Key, Value>::~cacheLRU()
+//constructor with a comparator for the keys
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+cacheLRU<Key, Value, Alloc, Compare, Tree>::cacheLRU(int capacity, const Compare& comp, const Alloc& alloc)
 {
+	cache_splay = new EntryTree(comp, typename EntryTree::allocator_type(alloc));
+	max_capacity = capacity;
+	size = 0;
+	newest = nullptr;
+	oldest = nullptr;
+}
+
+//destructor
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+cacheLRU<Key, Value, Alloc, Compare, Tree>::~cacheLRU()
+{
+	//entries kept out of the tree are only reachable through the recency list
+	if(!StableItems<Tree>::value)
+	{
+		while(newest != nullptr)
+		{
+			Entry* entry = newest;
+			newest = entry->older;
+			destroyEntry(entry, StableTag());
+		}
+	}
 	delete cache_splay;
 }
 
-//put function
-template <typename Key, typename Value>
-void cacheLRU<Key, Value>::put(const std::pair<const Key, Value>& keyValuePair)
+/**
+* Caches a key/value pair as the most recently used entry. A key already cached has its value replaced
+* in place; a new key that takes the cache over capacity evicts the least recently used entry.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+void cacheLRU<Key, Value, Alloc, Compare, Tree>::put(const std::pair<const Key, Value>& keyValuePair)
 {
-	if(size == max_capacity)
+	typename EntryTree::iterator found(cache_splay->find(keyValuePair.first));
+	if(found != cache_splay->end())
 	{
-		cache_splay->deleteMinLeaf();
-		cache_splay->insert(keyValuePair);
+		Entry* entry = entryOf(*found);
+		entry->value = keyValuePair.second;
+		touch(entry);
+		return;
 	}
-	//if less
-	else
+	linkNewest(insertEntry(keyValuePair.first, keyValuePair.second, StableTag()));
+	size++;
+	while(size > max_capacity && oldest != nullptr) evictOldest();
+}
+
+//get, which makes the entry the most recently used one
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+std::pair<const Key, Value> cacheLRU<Key, Value, Alloc, Compare, Tree>::get(const Key& key)
+{
+	typename EntryTree::iterator find_cache(cache_splay->find(key));
+	if(find_cache == cache_splay->end()) throw std::logic_error("Key is not found");
+	Entry* entry = entryOf(*find_cache);
+	touch(entry);
+	return std::pair<const Key, Value>(find_cache->first, entry->value);
+}
+
+
+/**
+* Puts a batch of key/value pairs, sorted by key, with merged passes over the tree (see
+* SplayTree::findBatch and SplayTree::insertBatch) instead of a search per pair. Keys already cached are
+* found first so their recency links survive; the new ones go in with one batch insert. Entries are then
+* touched in input order, so the last pair ends up most recently used (and the last value of a repeated
+* key wins), and the oldest are evicted until the cache is back within capacity. Needs a Tree with batch
+* operations, such as SplayTree or BSplayTree.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+template <typename ForwardIt>
+void cacheLRU<Key, Value, Alloc, Compare, Tree>::putMany(ForwardIt first, ForwardIt last)
+{
+	std::vector<Key> keys;
+	for(ForwardIt it = first; it != last; ++it) keys.push_back(it->first);
+	std::vector<typename EntryTree::iterator> found(keys.size());
+	cache_splay->findBatch(keys.begin(), keys.end(), found.begin());
+	//one new item per missing key; the input is sorted, so repeats of a key are next to each other
+	std::vector<std::pair<Key, Stored> > fresh;
+	std::size_t i = 0;
+	try
+	{
+		for(ForwardIt it = first; it != last; ++it, ++i)
+		{
+			if(found[i] != cache_splay->end()) continue;
+			if(!fresh.empty() && !cache_splay->key_comp()(fresh.back().first, it->first)) continue;
+			fresh.push_back(std::pair<Key, Stored>(it->first, makeStored(it->first, it->second, StableTag())));
+		}
+		size += static_cast<int>(cache_splay->insertBatch(fresh.begin(), fresh.end()));
+	}
+	catch(...)
 	{
-		cache_splay->insert(keyValuePair);
-		size++;
+		//the batch insert goes in a run or a key at a time, so the tree may hold some of the new entries by
+		//now; none of their keys was cached before, so any of them found is taken out before it is freed
+		for(std::size_t j = 0; j < fresh.size(); j++)
+		{
+			if(cache_splay->find(fresh[j].first) != cache_splay->end()) cache_splay->remove(fresh[j].first);
+			destroyEntry(storedEntry(fresh[j].second), StableTag());
+		}
+		throw;
 	}
+	//every key is in the tree now, and the entries not yet on the recency list are the ones just inserted
+	cache_splay->findBatch(keys.begin(), keys.end(), found.begin());
+	i = 0;
+	for(ForwardIt it = first; it != last; ++it, ++i)
+	{
+		Entry* entry = entryOf(*found[i]);
+		entry->value = it->second;
+		if(entry->newer == nullptr && entry != newest) linkNewest(entry);
+		else touch(entry);
+	}
+	while(size > max_capacity && oldest != nullptr) evictOldest();
 }
-//get 
-template <typename Key, typename Value>
-std::pair<const Key, Value> cacheLRU<Key, Value>::get(const Key& key)
+
+/**
+* Gets a batch of keys, sorted, with one merged lookup (see SplayTree::findBatch), touching each entry
+* found in input order. For each key a pointer to the cached value, or nullptr if the key is not cached,
+* is written to out; the pointers stay valid until the next put. Returns the number of keys found. Needs
+* a Tree with batch operations, such as SplayTree.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+template <typename InputIt, typename OutputIt>
+std::size_t cacheLRU<Key, Value, Alloc, Compare, Tree>::getMany(InputIt first, InputIt last, OutputIt out)
+{
+	//turns the tree's iterators into value pointers as they are written, so no buffer is needed
+	struct ValueWriter
+	{
+		cacheLRU* cache;
+		OutputIt* out;
+		std::size_t* found;
+
+		ValueWriter& operator*() { return *this; }
+		ValueWriter& operator++() { return *this; }
+		ValueWriter& operator=(const typename EntryTree::iterator& it)
+		{
+			if(it == cache->cache_splay->end()) **out = nullptr;
+			else
+			{
+				Entry* entry = entryOf(*it);
+				cache->touch(entry);
+				**out = &entry->value;
+				(*found)++;
+			}
+			++*out;
+			return *this;
+		}
+	};
+	std::size_t found = 0;
+	ValueWriter writer = { this, &out, &found };
+	cache_splay->findBatch(first, last, writer);
+	return found;
+}
+
+//puts an unlinked entry at the front of the recency list
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+void cacheLRU<Key, Value, Alloc, Compare, Tree>::linkNewest(Entry* entry)
+{
+	entry->newer = nullptr;
+	entry->older = newest;
+	if(newest != nullptr) newest->newer = entry;
+	else oldest = entry;
+	newest = entry;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+void cacheLRU<Key, Value, Alloc, Compare, Tree>::unlink(Entry* entry)
+{
+	if(entry->newer != nullptr) entry->newer->older = entry->older;
+	else newest = entry->older;
+	if(entry->older != nullptr) entry->older->newer = entry->newer;
+	else oldest = entry->newer;
+}
+
+//marks an entry as the most recently used
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+void cacheLRU<Key, Value, Alloc, Compare, Tree>::touch(Entry* entry)
+{
+	if(entry == newest) return;
+	unlink(entry);
+	linkNewest(entry);
+}
+
+//removes the least recently used entry; the key is copied first since removing frees the one it points at
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+void cacheLRU<Key, Value, Alloc, Compare, Tree>::evictOldest()
+{
+	Entry* victim = oldest;
+	if(victim == nullptr) return;
+	unlink(victim);
+	Key key(*victim->key);
+	cache_splay->remove(key);
+	destroyEntry(victim, StableTag());
+	size--;
+}
+
+//adds a new key to the tree and returns its entry, which is not on the recency list yet
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+typename cacheLRU<Key, Value, Alloc, Compare, Tree>::Entry* cacheLRU<Key, Value, Alloc, Compare, Tree>::insertEntry(
+	const Key& key, const Value& value, std::true_type)
+{
+	//the entry was copied into the tree, and that copy is the one to link
+	return entryOf(*cache_splay->insert(std::pair<const Key, Entry>(key, Entry(value))));
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+typename cacheLRU<Key, Value, Alloc, Compare, Tree>::Entry* cacheLRU<Key, Value, Alloc, Compare, Tree>::insertEntry(
+	const Key& key, const Value& value, std::false_type)
+{
+	OwnedEntry* entry = makeStored(key, value, std::false_type());
+	try
+	{
+		cache_splay->insert(std::pair<const Key, OwnedEntry*>(key, entry));
+	}
+	catch(...)
+	{
+		destroyEntry(entry, std::false_type());
+		throw;
+	}
+	return entry;
+}
+
+//what the tree holds for a new key: the entry itself, or one allocated with the tree's allocator
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+typename cacheLRU<Key, Value, Alloc, Compare, Tree>::Entry cacheLRU<Key, Value, Alloc, Compare, Tree>::makeStored(
+	const Key&, const Value& value, std::true_type)
+{
+	return Entry(value);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+typename cacheLRU<Key, Value, Alloc, Compare, Tree>::OwnedEntry* cacheLRU<Key, Value, Alloc, Compare, Tree>::makeStored(
+	const Key& key, const Value& value, std::false_type)
+{
+	EntryAllocator alloc(cache_splay->get_allocator());
+	OwnedEntry* entry = EntryAllocatorTraits::allocate(alloc, 1);
+	try
+	{
+		EntryAllocatorTraits::construct(alloc, entry, key, value);
+	}
+	catch(...)
+	{
+		EntryAllocatorTraits::deallocate(alloc, entry, 1);
+		throw;
+	}
+	return entry;
+}
+
+//entries stored in the tree go with their item, so only entries of their own need freeing
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+void cacheLRU<Key, Value, Alloc, Compare, Tree>::destroyEntry(Entry*, std::true_type)
+{
+
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+void cacheLRU<Key, Value, Alloc, Compare, Tree>::destroyEntry(Entry* entry, std::false_type)
+{
+	EntryAllocator alloc(cache_splay->get_allocator());
+	OwnedEntry* owned = static_cast<OwnedEntry*>(entry);
+	EntryAllocatorTraits::destroy(alloc, owned);
+	EntryAllocatorTraits::deallocate(alloc, owned, 1);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+typename cacheLRU<Key, Value, Alloc, Compare, Tree>::Entry* cacheLRU<Key, Value, Alloc, Compare, Tree>::storedEntry(Entry& stored)
+{
+	return &stored;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+typename cacheLRU<Key, Value, Alloc, Compare, Tree>::Entry* cacheLRU<Key, Value, Alloc, Compare, Tree>::storedEntry(OwnedEntry* stored)
+{
+	return stored;
+}
+
+//the entry behind an item of the tree, with its key pointer set for entries stored in the tree itself
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+typename cacheLRU<Key, Value, Alloc, Compare, Tree>::Entry* cacheLRU<Key, Value, Alloc, Compare, Tree>::entryOf(
+	std::pair<const Key, Entry>& item)
+{
+	item.second.key = &item.first;
+	return &item.second;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare, typename Tree>
+typename cacheLRU<Key, Value, Alloc, Compare, Tree>::Entry* cacheLRU<Key, Value, Alloc, Compare, Tree>::entryOf(
+	std::pair<const Key, OwnedEntry*>& item)
 {
-	typename SplayTree<Key, Value>::iterator find_cache(cache_splay->find(key));
-	if(find_cache != cache_splay->end()) return *find_cache;
-	else throw std::logic_error("Key is not found");
+	return item.second;
 }
 
 #endif
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <list>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "cacheLRU.h"
+#include "avlTree.h"
+#include "redBlackTree.h"
+#include "treap.h"
+
+/**
+* Checks cacheLRU hit for hit against a plain LRU built from std::list and std::map, on traces where LRU
+* behaves in the interesting ways: Zipf-distributed keys, where recency tracks popularity, and a loop
+* over more keys than fit, where LRU misses every time.
+*/
+
+//the reference: the list holds keys newest first and the map holds each value and its place in the list
+class ReferenceLRU
+{
+public:
+	explicit ReferenceLRU(std::size_t capacity) : mCapacity(capacity) { }
+
+	bool get(int key, int* value)
+	{
+		std::map<int, std::pair<int, std::list<int>::iterator> >::iterator it = mEntries.find(key);
+		if(it == mEntries.end()) return false;
+		mOrder.splice(mOrder.begin(), mOrder, it->second.second);
+		*value = it->second.first;
+		return true;
+	}
+
+	void put(int key, int value)
+	{
+		std::map<int, std::pair<int, std::list<int>::iterator> >::iterator it = mEntries.find(key);
+		if(it != mEntries.end())
+		{
+			it->second.first = value;
+			mOrder.splice(mOrder.begin(), mOrder, it->second.second);
+			return;
+		}
+		mOrder.push_front(key);
+		mEntries[key] = std::make_pair(value, mOrder.begin());
+		if(mEntries.size() > mCapacity)
+		{
+			mEntries.erase(mOrder.back());
+			mOrder.pop_back();
+		}
+	}
+private:
+	std::size_t mCapacity;
+	std::list<int> mOrder;
+	std::map<int, std::pair<int, std::list<int>::iterator> > mEntries;
+};
+
+//n keys drawn from [0, universe) with probability proportional to 1 / rank^s, ranks scattered over the keys
+std::vector<int> zipfTrace(std::size_t n, int universe, double s, unsigned seed)
+{
+	std::vector<double> cdf(universe);
+	double sum = 0;
+	for(int i = 0; i < universe; i++)
+	{
+		sum += 1 / std::pow(i + 1, s);
+		cdf[i] = sum;
+	}
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> uniform(0, sum);
+	std::vector<int> trace(n);
+	for(std::size_t i = 0; i < n; i++)
+	{
+		long rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+		trace[i] = static_cast<int>(rank * 7919 % universe);
+	}
+	return trace;
+}
+
+std::vector<int> loopTrace(int keys, int rounds)
+{
+	std::vector<int> trace;
+	for(int r = 0; r < rounds; r++)
+	{
+		for(int i = 0; i < keys; i++) trace.push_back(i);
+	}
+	return trace;
+}
+
+//gets every key of the trace and puts it on a miss; returns the hit ratio, which the reference must match
+template <typename Cache>
+double replay(const std::vector<int>& trace, int capacity)
+{
+	Cache cache(capacity);
+	ReferenceLRU reference(capacity);
+	std::size_t hits = 0;
+	for(std::size_t i = 0; i < trace.size(); i++)
+	{
+		int expected;
+		bool referenceHit = reference.get(trace[i], &expected);
+		bool hit = true;
+		int value = 0;
+		try
+		{
+			value = cache.get(trace[i]).second;
+		}
+		catch(const std::logic_error&)
+		{
+			hit = false;
+		}
+		assert(hit == referenceHit);
+		if(hit)
+		{
+			assert(value == expected);
+			hits++;
+		}
+		else
+		{
+			cache.put(std::make_pair(trace[i], static_cast<int>(i)));
+			reference.put(trace[i], static_cast<int>(i));
+		}
+	}
+	return static_cast<double>(hits) / trace.size();
+}
+
+//random sorted batches through putMany and getMany, some with repeated keys
+template <typename Cache>
+void replayBatches()
+{
+	std::mt19937 rng(4);
+	Cache cache(300);
+	ReferenceLRU reference(300);
+	for(int round = 0; round < 3000; round++)
+	{
+		std::vector<std::pair<int, int> > batch;
+		int n = rng() % 20;
+		for(int i = 0; i < n; i++) batch.push_back(std::make_pair(static_cast<int>(rng() % 1000), round * 100 + i));
+		std::stable_sort(batch.begin(), batch.end(),
+			[](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first < b.first; });
+		if(rng() % 2)
+		{
+			cache.putMany(batch.begin(), batch.end());
+			for(std::size_t i = 0; i < batch.size(); i++) reference.put(batch[i].first, batch[i].second);
+		}
+		else
+		{
+			std::vector<int> keys;
+			for(std::size_t i = 0; i < batch.size(); i++) keys.push_back(batch[i].first);
+			std::vector<int*> values(keys.size());
+			std::size_t found = cache.getMany(keys.begin(), keys.end(), values.begin());
+			std::size_t referenceFound = 0;
+			for(std::size_t i = 0; i < keys.size(); i++)
+			{
+				int expected;
+				bool hit = reference.get(keys[i], &expected);
+				assert(hit == (values[i] != nullptr));
+				if(hit)
+				{
+					assert(*values[i] == expected);
+					referenceFound++;
+				}
+			}
+			assert(found == referenceFound);
+		}
+	}
+}
+
+//an allocator whose allocation fails once when allocationsLeft runs out, to fail putMany part way through
+static int allocationsLeft = -1;
+
+template <typename T>
+struct FailingAllocator
+{
+	typedef T value_type;
+
+	FailingAllocator() { }
+	template <typename U>
+	FailingAllocator(const FailingAllocator<U>&) { }
+
+	T* allocate(std::size_t n)
+	{
+		if(allocationsLeft > 0) allocationsLeft--;
+		else if(allocationsLeft == 0)
+		{
+			allocationsLeft = -1;
+			throw std::bad_alloc();
+		}
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T* pointer, std::size_t n)
+	{
+		std::allocator<T>().deallocate(pointer, n);
+	}
+};
+
+template <typename T, typename U>
+bool operator==(const FailingAllocator<T>&, const FailingAllocator<U>&)
+{
+	return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const FailingAllocator<T>&, const FailingAllocator<U>&)
+{
+	return false;
+}
+
+//a putMany whose new keys fail to go in leaves the cache as it was; the cache never fills, so that every
+//allocation that can fail is one made before the batch is applied
+template <typename Cache>
+void replayFailedBatches()
+{
+	std::mt19937 rng(5);
+	Cache cache(1000);
+	ReferenceLRU reference(1000);
+	int failures = 0;
+	for(int round = 0; round < 3000; round++)
+	{
+		std::vector<std::pair<int, int> > batch;
+		int n = rng() % 30;
+		for(int i = 0; i < n; i++) batch.push_back(std::make_pair(static_cast<int>(rng() % 500), round * 100 + i));
+		std::stable_sort(batch.begin(), batch.end(),
+			[](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first < b.first; });
+		allocationsLeft = rng() % 2 ? static_cast<int>(rng() % 40) : -1;
+		try
+		{
+			cache.putMany(batch.begin(), batch.end());
+			for(std::size_t i = 0; i < batch.size(); i++) reference.put(batch[i].first, batch[i].second);
+		}
+		catch(const std::bad_alloc&)
+		{
+			failures++;
+		}
+		allocationsLeft = -1;
+		for(int i = 0; i < 5; i++)
+		{
+			int key = rng() % 500;
+			int expected;
+			if(reference.get(key, &expected))
+			{
+				assert(cache.get(key).second == expected);
+				continue;
+			}
+			bool missing = false;
+			try
+			{
+				cache.get(key);
+			}
+			catch(const std::logic_error&)
+			{
+				missing = true;
+			}
+			assert(missing);
+		}
+	}
+	assert(failures > 0);
+}
+
+int main()
+{
+	typedef std::allocator<std::pair<const int, int> > Alloc;
+	std::vector<int> zipfLow = zipfTrace(300000, 100000, 0.9, 1);
+	std::vector<int> zipfHigh = zipfTrace(300000, 20000, 1.1, 2);
+	std::vector<int> loop = loopTrace(5000, 30);
+
+	int capacities[] = { 100, 1000, 10000 };
+	for(int i = 0; i < 3; i++)
+	{
+		std::printf("zipf 0.9, capacity %d: hit ratio %.4f\n", capacities[i],
+			replay<cacheLRU<int, int> >(zipfLow, capacities[i]));
+		std::printf("zipf 1.1, capacity %d: hit ratio %.4f\n", capacities[i],
+			replay<cacheLRU<int, int> >(zipfHigh, capacities[i]));
+	}
+	//a loop one key longer than the cache evicts each key just before it comes round again
+	double loopRatio = replay<cacheLRU<int, int> >(loop, 4999);
+	std::printf("loop of 5000, capacity 4999: hit ratio %.4f\n", loopRatio);
+	assert(loopRatio == 0);
+	assert((replay<cacheLRU<int, int> >(loop, 5000) > 0.96));
+
+	replay<cacheLRU<int, int, Alloc, std::less<int>, AVLTree<int, int> > >(zipfLow, 1000);
+	replay<cacheLRU<int, int, Alloc, std::less<int>, RedBlackTree<int, int> > >(zipfLow, 1000);
+	replay<cacheLRU<int, int, Alloc, std::less<int>, Treap<int, int> > >(zipfLow, 1000);
+	replay<cacheLRU<int, int, Alloc, std::less<int>, BSplayTree<int, int> > >(zipfLow, 1000);
+	replayBatches<cacheLRU<int, int> >();
+	replayBatches<cacheLRU<int, int, Alloc, std::less<int>, BSplayTree<int, int> > >();
+	typedef FailingAllocator<std::pair<const int, int> > FailingAlloc;
+	replayFailedBatches<cacheLRU<int, int, FailingAlloc> >();
+	replayFailedBatches<cacheLRU<int, int, FailingAlloc, std::less<int>, BSplayTree<int, int, FailingAlloc, std::less<int>, 2> > >();
+
+	std::printf("cacheLRU: ok\n");
+	return 0;
+}
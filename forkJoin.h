@@ -0,0 +1,72 @@
+#ifndef FORK_JOIN_H
+#define FORK_JOIN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <future>
+#include <system_error>
+#include <thread>
+
+/**
+* Runs f and g and returns once both are done. With parallel set, f runs on a thread of its own while g
+* runs on the caller's; if no thread can be started, both simply run here. An exception from either is
+* rethrown after both have finished.
+*/
+template <typename F, typename G>
+void forkJoin(F f, G g, bool parallel)
+{
+	if(!parallel)
+	{
+		f();
+		g();
+		return;
+	}
+	std::future<void> forked;
+	try
+	{
+		forked = std::async(std::launch::async, f);
+	}
+	catch(const std::system_error&)
+	{
+		f();
+		g();
+		return;
+	}
+	//the future's destructor waits for f even if g throws
+	g();
+	forked.get();
+}
+
+/**
+* How many levels of a binary divide and conquer should fork to keep threads busy (0 means the hardware
+* concurrency). About four tasks per thread are made, so uneven halves still even out.
+*/
+inline std::size_t forkDepth(std::size_t threads)
+{
+	if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	if(threads == 1) return 0;
+	std::size_t depth = 2;
+	while((static_cast<std::size_t>(1) << (depth - 2)) < threads) depth++;
+	return depth;
+}
+
+/**
+* std::stable_sort with the two halves sorted in parallel down to the given fork depth and merged in
+* place on the way back up. Small ranges are not worth a thread and are sorted directly.
+*/
+template <typename RandomIt, typename Compare>
+void parallelStableSort(RandomIt first, RandomIt last, Compare comp, std::size_t depth)
+{
+	const std::ptrdiff_t serialCutoff = 1 << 14;
+	if(depth == 0 || last - first < serialCutoff)
+	{
+		std::stable_sort(first, last, comp);
+		return;
+	}
+	RandomIt mid = first + (last - first) / 2;
+	forkJoin([first, mid, comp, depth]() { parallelStableSort(first, mid, comp, depth - 1); },
+		[mid, last, comp, depth]() { parallelStableSort(mid, last, comp, depth - 1); }, true);
+	std::inplace_merge(first, mid, last, comp);
+}
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef FROZEN_INDEX_H
+#define FROZEN_INDEX_H
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "bst.h"
+
+/**
+* An immutable map built from sorted items, for trees that are built once and then only read. The keys
+* sit in one array in Eytzinger (breadth-first) order: the children of slot k are slots 2k and 2k + 1,
+* counting from one. A search is a loop without data-dependent branches, and since the descendants four
+* levels down are adjacent, each step prefetches them long before they are needed. Values live in a
+* parallel array and are only touched once the key is found.
+*
+* Every member is const and nothing is cached, so any number of threads can query one index at once.
+* SplayTree::freeze builds one and SplayTree::thaw turns it back into a tree.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class FrozenIndex
+{
+public:
+	explicit FrozenIndex(const Compare& comp = Compare());
+	template <typename ForwardIt>
+	FrozenIndex(ForwardIt first, ForwardIt last, const Compare& comp = Compare());
+
+	const Value* find(const Key& key) const;
+	bool contains(const Key& key) const;
+	std::size_t size() const;
+	bool empty() const;
+	template <typename Callback>
+	void forEach(Callback callback) const;
+	Compare key_comp() const;
+
+protected:
+	static void fillRanks(std::size_t k, std::size_t n, std::size_t& next, std::vector<std::size_t>& ranks);
+	std::size_t lowerBoundSlot(const Key& key) const;
+	template <typename Callback>
+	void visitInOrder(std::size_t k, Callback& callback) const;
+
+	std::vector<Key> mKeys;
+	std::vector<Value> mValues;
+	Compare mCompare;
+};
+
+/*
+	------------------------------------------------
+	Begin implementations for the FrozenIndex class.
+	------------------------------------------------
+*/
+
+template <typename Key, typename Value, typename Compare>
+FrozenIndex<Key, Value, Compare>::FrozenIndex(const Compare& comp)
+	: mCompare(comp)
+{
+
+}
+
+/**
+* Builds the index from the key/value pairs in [first, last), which must be sorted by key with no key
+* repeated, as a tree's iterators produce them. O(n).
+*/
+template <typename Key, typename Value, typename Compare>
+template <typename ForwardIt>
+FrozenIndex<Key, Value, Compare>::FrozenIndex(ForwardIt first, ForwardIt last, const Compare& comp)
+	: mCompare(comp)
+{
+	std::vector<ForwardIt> sorted;
+	for(; first != last; ++first) sorted.push_back(first);
+	std::size_t n = sorted.size();
+	//ranks[k - 1] is the position in key order of the item that goes in slot k
+	std::vector<std::size_t> ranks(n);
+	std::size_t next = 0;
+	fillRanks(1, n, next, ranks);
+	mKeys.reserve(n);
+	mValues.reserve(n);
+	for(std::size_t k = 0; k < n; k++)
+	{
+		mKeys.push_back(sorted[ranks[k]]->first);
+		mValues.push_back(sorted[ranks[k]]->second);
+	}
+}
+
+/**
+* Returns a pointer to the value stored under key, or nullptr if the key is missing. O(log n) with no
+* branch on the comparisons, so the cost hardly depends on the keys searched.
+*/
+template <typename Key, typename Value, typename Compare>
+const Value* FrozenIndex<Key, Value, Compare>::find(const Key& key) const
+{
+	std::size_t k = lowerBoundSlot(key);
+	if(k == 0 || mCompare(key, mKeys[k - 1])) return nullptr;
+	return &mValues[k - 1];
+}
+
+template <typename Key, typename Value, typename Compare>
+bool FrozenIndex<Key, Value, Compare>::contains(const Key& key) const
+{
+	return find(key) != nullptr;
+}
+
+template <typename Key, typename Value, typename Compare>
+std::size_t FrozenIndex<Key, Value, Compare>::size() const
+{
+	return mKeys.size();
+}
+
+template <typename Key, typename Value, typename Compare>
+bool FrozenIndex<Key, Value, Compare>::empty() const
+{
+	return mKeys.empty();
+}
+
+/**
+* Calls callback(key, value) for every item in key order.
+*/
+template <typename Key, typename Value, typename Compare>
+template <typename Callback>
+void FrozenIndex<Key, Value, Compare>::forEach(Callback callback) const
+{
+	visitInOrder(1, callback);
+}
+
+template <typename Key, typename Value, typename Compare>
+Compare FrozenIndex<Key, Value, Compare>::key_comp() const
+{
+	return mCompare;
+}
+
+//an in-order walk of the implicit tree hands out the ranks, so slot k gets the item it must hold
+template <typename Key, typename Value, typename Compare>
+void FrozenIndex<Key, Value, Compare>::fillRanks(std::size_t k, std::size_t n, std::size_t& next, std::vector<std::size_t>& ranks)
+{
+	if(k > n) return;
+	fillRanks(2 * k, n, next, ranks);
+	ranks[k - 1] = next++;
+	fillRanks(2 * k + 1, n, next, ranks);
+}
+
+/**
+* Returns the slot (counting from one) of the first key not less than key, or 0 if there is none. The
+* descent always runs to the bottom and records each turn as a bit of k: a right turn appends a one. The
+* lower bound is the last node where it turned left, which is found by stripping the trailing ones and
+* the zero before them.
+*/
+template <typename Key, typename Value, typename Compare>
+std::size_t FrozenIndex<Key, Value, Compare>::lowerBoundSlot(const Key& key) const
+{
+	//slots 16k to 16k + 15 are the descendants of k four levels down, one cache line for small keys
+	const std::size_t ahead = 16;
+	const Key* keys = mKeys.data();
+	std::size_t n = mKeys.size();
+	std::size_t k = 1;
+	while(k <= n)
+	{
+		if(ahead * k <= n) prefetchNode(keys + ahead * k - 1);
+		k = 2 * k + static_cast<std::size_t>(mCompare(keys[k - 1], key));
+	}
+#if defined(__GNUC__) || defined(__clang__)
+	k >>= __builtin_ctzll(~static_cast<unsigned long long>(k)) + 1;
+#else
+	while(k & 1) k >>= 1;
+	k >>= 1;
+#endif
+	return k;
+}
+
+template <typename Key, typename Value, typename Compare>
+template <typename Callback>
+void FrozenIndex<Key, Value, Compare>::visitInOrder(std::size_t k, Callback& callback) const
+{
+	if(k > mKeys.size()) return;
+	visitInOrder(2 * k, callback);
+	callback(mKeys[k - 1], mValues[k - 1]);
+	visitInOrder(2 * k + 1, callback);
+}
+
+/*
+	----------------------------------------------
+	End implementations for the FrozenIndex class.
+	----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,383 @@
+#ifndef HOT_COLD_NODE_H
+#define HOT_COLD_NODE_H
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "splayTree.h"
+
+/**
+* A splay tree node split into a hot part and a cold part. The hot part holds a copy of the key and the
+* links, which is all a descent touches, so it stays small no matter how large Value is. The cold part
+* is the full key/value item, kept out of line and only touched once the search has found its node.
+*
+* The node does not allocate its item. A ColdItemAllocator builds the item in the tree's cold arena and
+* hands it to the node, so the node type is only usable with that allocator.
+*/
+template <typename Key, typename Value>
+class HotColdSplayNode
+{
+public:
+	static const bool AUGMENTED = false;
+
+	typedef std::pair<const Key, Value> Item;
+
+	HotColdSplayNode(Item* item, HotColdSplayNode<Key, Value>* parent);
+
+	const std::pair<const Key, Value>& getItem() const;
+	std::pair<const Key, Value>& getItem();
+	const Key& getKey() const;
+	const Value& getValue() const;
+	Value& getValue();
+
+	HotColdSplayNode<Key, Value>* getParent() const;
+	HotColdSplayNode<Key, Value>* getLeft() const;
+	HotColdSplayNode<Key, Value>* getRight() const;
+
+	void setParent(HotColdSplayNode<Key, Value>* parent);
+	void setLeft(HotColdSplayNode<Key, Value>* left);
+	void setRight(HotColdSplayNode<Key, Value>* right);
+	void setKey(const Key& key);
+	void setValue(const Value &value);
+	void recompute();
+	void copyBalance(const HotColdSplayNode<Key, Value>& other);
+
+protected:
+	Key mKey;
+	HotColdSplayNode<Key, Value>* mParent;
+	HotColdSplayNode<Key, Value>* mLeft;
+	HotColdSplayNode<Key, Value>* mRight;
+	std::pair<const Key, Value>* mItem;
+
+private:
+	HotColdSplayNode(const HotColdSplayNode& other);
+	HotColdSplayNode& operator=(const HotColdSplayNode& other);
+};
+
+/**
+* Marks the node types whose item lives out of line and is built by ColdItemAllocator.
+*/
+template <typename NodeType>
+struct HasColdItem : std::false_type
+{
+
+};
+
+template <typename Key, typename Value>
+struct HasColdItem<HotColdSplayNode<Key, Value> > : std::true_type
+{
+
+};
+
+/**
+* The allocator for nodes that keep their item out of line. Nodes come from operator new like
+* std::allocator's; their items come from a SlabPool that copies and rebound copies of the allocator
+* share, so the cold arena lives exactly as long as the tree (and anything else holding its allocator).
+* Constructing a node first builds its item in the arena and then passes it to the node, and destroying
+* the node destroys the item and returns it to the arena. Everything else is constructed in place as
+* usual.
+*/
+template <typename T>
+class ColdItemAllocator
+{
+public:
+	typedef T value_type;
+
+	ColdItemAllocator();
+	template <typename U>
+	ColdItemAllocator(const ColdItemAllocator<U>& other);
+
+	T* allocate(std::size_t n);
+	void deallocate(T* p, std::size_t n);
+	template <typename U, typename... Args>
+	void construct(U* p, Args&&... args);
+	template <typename U>
+	void destroy(U* p);
+	ColdItemAllocator<T> select_on_container_copy_construction() const;
+
+	template <typename U>
+	bool operator==(const ColdItemAllocator<U>& rhs) const;
+	template <typename U>
+	bool operator!=(const ColdItemAllocator<U>& rhs) const;
+
+	std::shared_ptr<SlabPool> mPool;
+
+private:
+	template <typename NodeType, typename K, typename V>
+	void constructIn(NodeType* node, std::true_type, const K& key, const V& value, NodeType* parent);
+	template <typename U, typename... Args>
+	void constructIn(U* p, std::false_type, Args&&... args);
+	template <typename NodeType>
+	void destroyIn(NodeType* node, std::true_type);
+	template <typename U>
+	void destroyIn(U* p, std::false_type);
+	template <typename Item>
+	void freeItem(Item* item);
+};
+
+/**
+* A SplayTree whose values live out of line. The public interface is the same as SplayTree's.
+*/
+template <typename Key, typename Value>
+using HotColdSplayTree = SplayTree<Key, Value, HotColdSplayNode<Key, Value>,
+	ColdItemAllocator<std::pair<const Key, Value> > >;
+
+/*
+	-----------------------------------------------------
+	Begin implementations for the ColdItemAllocator class.
+	-----------------------------------------------------
+*/
+
+template <typename T>
+ColdItemAllocator<T>::ColdItemAllocator()
+	: mPool(std::make_shared<SlabPool>(false))
+{
+
+}
+
+template <typename T>
+template <typename U>
+ColdItemAllocator<T>::ColdItemAllocator(const ColdItemAllocator<U>& other)
+	: mPool(other.mPool)
+{
+
+}
+
+template <typename T>
+T* ColdItemAllocator<T>::allocate(std::size_t n)
+{
+	return static_cast<T*>(::operator new(n * sizeof(T)));
+}
+
+template <typename T>
+void ColdItemAllocator<T>::deallocate(T* p, std::size_t)
+{
+	::operator delete(p);
+}
+
+template <typename T>
+template <typename U, typename... Args>
+void ColdItemAllocator<T>::construct(U* p, Args&&... args)
+{
+	constructIn(p, HasColdItem<U>(), std::forward<Args>(args)...);
+}
+
+template <typename T>
+template <typename U>
+void ColdItemAllocator<T>::destroy(U* p)
+{
+	destroyIn(p, HasColdItem<U>());
+}
+
+//a copied tree gets an arena of its own rather than sharing the original's
+template <typename T>
+ColdItemAllocator<T> ColdItemAllocator<T>::select_on_container_copy_construction() const
+{
+	return ColdItemAllocator<T>();
+}
+
+template <typename T>
+template <typename U>
+bool ColdItemAllocator<T>::operator==(const ColdItemAllocator<U>& rhs) const
+{
+	return mPool == rhs.mPool;
+}
+
+template <typename T>
+template <typename U>
+bool ColdItemAllocator<T>::operator!=(const ColdItemAllocator<U>& rhs) const
+{
+	return mPool != rhs.mPool;
+}
+
+//builds the item in the arena, then the node around it
+template <typename T>
+template <typename NodeType, typename K, typename V>
+void ColdItemAllocator<T>::constructIn(NodeType* node, std::true_type, const K& key, const V& value, NodeType* parent)
+{
+	typedef typename NodeType::Item Item;
+	void* cold = mPool->owns(sizeof(Item)) ? mPool->allocate(sizeof(Item)) : ::operator new(sizeof(Item));
+	Item* item;
+	try
+	{
+		item = ::new(cold) Item(key, value);
+	}
+	catch(...)
+	{
+		if(mPool->owns(sizeof(Item))) mPool->deallocate(cold, sizeof(Item));
+		else ::operator delete(cold);
+		throw;
+	}
+	try
+	{
+		::new(static_cast<void*>(node)) NodeType(item, parent);
+	}
+	catch(...)
+	{
+		freeItem(item);
+		throw;
+	}
+}
+
+template <typename T>
+template <typename U, typename... Args>
+void ColdItemAllocator<T>::constructIn(U* p, std::false_type, Args&&... args)
+{
+	::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+}
+
+template <typename T>
+template <typename NodeType>
+void ColdItemAllocator<T>::destroyIn(NodeType* node, std::true_type)
+{
+	typename NodeType::Item* item = &node->getItem();
+	node->~NodeType();
+	freeItem(item);
+}
+
+template <typename T>
+template <typename U>
+void ColdItemAllocator<T>::destroyIn(U* p, std::false_type)
+{
+	p->~U();
+}
+
+//destroys an item and hands its memory back to the arena
+template <typename T>
+template <typename Item>
+void ColdItemAllocator<T>::freeItem(Item* item)
+{
+	item->~Item();
+	if(mPool->owns(sizeof(Item))) mPool->deallocate(item, sizeof(Item));
+	else ::operator delete(item);
+}
+
+/*
+	---------------------------------------------------
+	End implementations for the ColdItemAllocator class.
+	---------------------------------------------------
+*/
+
+/*
+	-----------------------------------------------------
+	Begin implementations for the HotColdSplayNode class.
+	-----------------------------------------------------
+*/
+
+/**
+* Explicit constructor for a node around an item already built in the cold arena.
+*/
+template<typename Key, typename Value>
+HotColdSplayNode<Key, Value>::HotColdSplayNode(Item* item, HotColdSplayNode<Key, Value>* parent)
+	: mKey(item->first)
+	, mParent(parent)
+	, mLeft(NULL)
+	, mRight(NULL)
+	, mItem(item)
+{
+
+}
+
+template<typename Key, typename Value>
+const std::pair<const Key, Value>& HotColdSplayNode<Key, Value>::getItem() const
+{
+	return *mItem;
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>& HotColdSplayNode<Key, Value>::getItem()
+{
+	return *mItem;
+}
+
+//the hot copy of the key, compared during descent without touching the cold item
+template<typename Key, typename Value>
+const Key& HotColdSplayNode<Key, Value>::getKey() const
+{
+	return mKey;
+}
+
+template<typename Key, typename Value>
+const Value& HotColdSplayNode<Key, Value>::getValue() const
+{
+	return mItem->second;
+}
+
+template<typename Key, typename Value>
+Value& HotColdSplayNode<Key, Value>::getValue()
+{
+	return mItem->second;
+}
+
+template<typename Key, typename Value>
+HotColdSplayNode<Key, Value>* HotColdSplayNode<Key, Value>::getParent() const
+{
+	return mParent;
+}
+
+template<typename Key, typename Value>
+HotColdSplayNode<Key, Value>* HotColdSplayNode<Key, Value>::getLeft() const
+{
+	return mLeft;
+}
+
+template<typename Key, typename Value>
+HotColdSplayNode<Key, Value>* HotColdSplayNode<Key, Value>::getRight() const
+{
+	return mRight;
+}
+
+template<typename Key, typename Value>
+void HotColdSplayNode<Key, Value>::setParent(HotColdSplayNode<Key, Value>* parent)
+{
+	mParent = parent;
+}
+
+template<typename Key, typename Value>
+void HotColdSplayNode<Key, Value>::setLeft(HotColdSplayNode<Key, Value>* left)
+{
+	mLeft = left;
+}
+
+template<typename Key, typename Value>
+void HotColdSplayNode<Key, Value>::setRight(HotColdSplayNode<Key, Value>* right)
+{
+	mRight = right;
+}
+
+//see NodeBase::setKey; the hot copy changes along with the item
+template<typename Key, typename Value>
+void HotColdSplayNode<Key, Value>::setKey(const Key& key)
+{
+	const_cast<Key&>(mItem->first) = key;
+	mKey = key;
+}
+
+template<typename Key, typename Value>
+void HotColdSplayNode<Key, Value>::setValue(const Value& value)
+{
+	mItem->second = value;
+}
+
+//splay nodes cache nothing about their subtree
+template<typename Key, typename Value>
+void HotColdSplayNode<Key, Value>::recompute()
+{
+
+}
+
+//nor keep any balancing state
+template<typename Key, typename Value>
+void HotColdSplayNode<Key, Value>::copyBalance(const HotColdSplayNode<Key, Value>&)
+{
+
+}
+
+/*
+	---------------------------------------------------
+	End implementations for the HotColdSplayNode class.
+	---------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,551 @@
+#ifndef INDEXED_NODE_H
+#define INDEXED_NODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+#include "splayTree.h"
+
+#if __cplusplus < 201703L && defined(_WIN32)
+#include <malloc.h>
+#endif
+
+/**
+* A growable pool of equally sized slots addressed by 32-bit indices. Slots live in fixed-size chunks, so
+* growing the pool never moves a node and node pointers handed out by the tree stay valid. Index i lives
+* in chunk i >> CHUNK_SHIFT at slot i & CHUNK_MASK. The slot size is fixed by the first allocation, as
+* with SlabPool.
+*
+* Each chunk is aligned to its own size and starts with a header naming its pool and its number, so an
+* object in a slot can find its pool from its own address; that is how a node turns its links back into
+* pointers without a pool pointer of its own. Pools belong to IndexPoolAllocator instances, and like the
+* trees themselves they are not thread safe.
+*/
+class IndexPool
+{
+public:
+	static const uint32_t NIL = 0xFFFFFFFFu;
+
+	IndexPool();
+	~IndexPool();
+
+	bool owns(std::size_t bytes) const;
+	void* allocate(std::size_t bytes, std::size_t align);
+	void deallocate(void* slot);
+	void release();
+	std::size_t size() const;
+
+	template <typename T>
+	static T* at(const T* from, uint32_t index);
+	template <typename T>
+	static uint32_t indexOf(const T* slot);
+
+private:
+	IndexPool(const IndexPool& other);
+	IndexPool& operator=(const IndexPool& other);
+
+	//the start of every chunk
+	struct ChunkHeader
+	{
+		IndexPool* pool;
+		uint32_t number;
+	};
+
+	static const uint32_t CHUNK_SHIFT = 14;
+	static const uint32_t CHUNK_MASK = (1u << CHUNK_SHIFT) - 1;
+
+	static constexpr std::size_t slotOffset(std::size_t align);
+	static constexpr std::size_t powerOfTwoAtLeast(std::size_t n, std::size_t power);
+	static constexpr std::size_t chunkBytes(std::size_t bytes, std::size_t align);
+	static void* allocateChunk(std::size_t bytes);
+	static void freeChunk(void* chunk, std::size_t bytes);
+
+	std::vector<char*> mChunks;
+	uint32_t mNext;
+	uint32_t mFree;
+	std::size_t mUsed;
+	std::size_t mSlotSize;
+	std::size_t mSlotOffset;
+	std::size_t mChunkBytes;
+};
+
+/**
+* A splay tree node whose links are 32-bit indices into IndexPool instead of 64-bit pointers. It offers
+* the same getters and setters as NodeBase, translating between indices and pointers on the way, so
+* rotateBST and SplayTree work on it unchanged. A node's own index comes from its address (see
+* IndexPool::indexOf), so it is not stored.
+*
+* The links take 12 bytes, so IndexedSplayNode<uint32_t, uint32_t> is 20 bytes against 32 for SplayNode.
+* A 64-bit key still makes 32 bytes: getItem() must return a std::pair<const Key, Value>, which pads
+* itself to 16 bytes, and the node rounds up to a multiple of the key's 8-byte alignment.
+*
+* Nodes must be allocated with IndexPoolAllocator, see IndexedSplayTree below, and can only be linked to
+* nodes from the same pool.
+*/
+template <typename Key, typename Value>
+class IndexedSplayNode
+{
+public:
+	static const bool AUGMENTED = false;
+
+	IndexedSplayNode(const Key& key, const Value& value, IndexedSplayNode<Key, Value>* parent);
+
+	const std::pair<const Key, Value>& getItem() const;
+	std::pair<const Key, Value>& getItem();
+	const Key& getKey() const;
+	const Value& getValue() const;
+	Value& getValue();
+
+	IndexedSplayNode<Key, Value>* getParent() const;
+	IndexedSplayNode<Key, Value>* getLeft() const;
+	IndexedSplayNode<Key, Value>* getRight() const;
+
+	void setParent(IndexedSplayNode<Key, Value>* parent);
+	void setLeft(IndexedSplayNode<Key, Value>* left);
+	void setRight(IndexedSplayNode<Key, Value>* right);
+	void setKey(const Key& key);
+	void setValue(const Value &value);
+	void recompute();
+	void copyBalance(const IndexedSplayNode<Key, Value>& other);
+
+protected:
+	IndexedSplayNode<Key, Value>* toNode(uint32_t index) const;
+	static uint32_t toIndex(const IndexedSplayNode<Key, Value>* node);
+
+	std::pair<const Key, Value> mItem;
+	uint32_t mParent;
+	uint32_t mLeft;
+	uint32_t mRight;
+};
+
+/**
+* A standard allocator backed by a shared IndexPool. Copies and rebound copies share the pool, so a tree
+* that rebinds the allocator to its node type draws from the pool the caller handed in, and trees whose
+* allocators compare equal can exchange nodes. Each default-constructed allocator has a pool of its own,
+* and so does the copy a tree makes when it is copied, so separate trees never share one. Single-object
+* requests of the pool's slot size come from the pool; anything else goes to operator new.
+*/
+template <typename T>
+class IndexPoolAllocator
+{
+public:
+	typedef T value_type;
+
+	IndexPoolAllocator();
+	template <typename U>
+	IndexPoolAllocator(const IndexPoolAllocator<U>& other);
+
+	T* allocate(std::size_t n);
+	void deallocate(T* p, std::size_t n);
+	bool release();
+	IndexPoolAllocator<T> select_on_container_copy_construction() const;
+
+	template <typename U>
+	bool operator==(const IndexPoolAllocator<U>& rhs) const;
+	template <typename U>
+	bool operator!=(const IndexPoolAllocator<U>& rhs) const;
+
+	std::shared_ptr<IndexPool> mPool;
+};
+
+template <typename T>
+struct AllocatorRelease<IndexPoolAllocator<T> >
+{
+	static bool release(IndexPoolAllocator<T>& alloc)
+	{
+		return alloc.release();
+	}
+};
+
+/**
+* A SplayTree with 32-bit index links. The public interface is the same as SplayTree's.
+*/
+template <typename Key, typename Value>
+using IndexedSplayTree = SplayTree<Key, Value, IndexedSplayNode<Key, Value>,
+	IndexPoolAllocator<std::pair<const Key, Value> > >;
+
+/*
+	---------------------------------------------
+	Begin implementations for the IndexPool class.
+	---------------------------------------------
+*/
+
+inline IndexPool::IndexPool()
+	: mNext(0)
+	, mFree(NIL)
+	, mUsed(0)
+	, mSlotSize(0)
+	, mSlotOffset(0)
+	, mChunkBytes(0)
+{
+
+}
+
+inline IndexPool::~IndexPool()
+{
+	release();
+}
+
+//slots start after the chunk header, at the first offset suitably aligned for the objects in them
+constexpr std::size_t IndexPool::slotOffset(std::size_t align)
+{
+	return (sizeof(ChunkHeader) + align - 1) / align * align;
+}
+
+constexpr std::size_t IndexPool::powerOfTwoAtLeast(std::size_t n, std::size_t power)
+{
+	return power >= n ? power : powerOfTwoAtLeast(n, power << 1);
+}
+
+//the header and the slots, rounded up to a power of two so chunks can be aligned to their size
+constexpr std::size_t IndexPool::chunkBytes(std::size_t bytes, std::size_t align)
+{
+	return powerOfTwoAtLeast(slotOffset(align) + (bytes << CHUNK_SHIFT), 1);
+}
+
+//a block of the given power-of-two size aligned to that size
+inline void* IndexPool::allocateChunk(std::size_t bytes)
+{
+#if __cplusplus >= 201703L
+	return ::operator new(bytes, std::align_val_t(bytes));
+#elif defined(_WIN32)
+	void* chunk = _aligned_malloc(bytes, bytes);
+	if(chunk == nullptr) throw std::bad_alloc();
+	return chunk;
+#else
+	void* chunk;
+	if(posix_memalign(&chunk, bytes, bytes) != 0) throw std::bad_alloc();
+	return chunk;
+#endif
+}
+
+inline void IndexPool::freeChunk(void* chunk, std::size_t bytes)
+{
+#if __cplusplus >= 201703L
+	::operator delete(chunk, std::align_val_t(bytes));
+#elif defined(_WIN32)
+	(void)bytes;
+	_aligned_free(chunk);
+#else
+	(void)bytes;
+	std::free(chunk);
+#endif
+}
+
+/**
+* Returns true if requests of this many bytes are served by the pool. The first request fixes the size;
+* slots must be big enough to hold a free list link.
+*/
+inline bool IndexPool::owns(std::size_t bytes) const
+{
+	return bytes >= sizeof(uint32_t) && (mSlotSize == 0 || mSlotSize == bytes);
+}
+
+/**
+* Hands out a free slot, reusing released ones first. The object built in it can find its index with
+* indexOf. Released slots form a list through their own first four bytes, so releasing never allocates.
+*/
+inline void* IndexPool::allocate(std::size_t bytes, std::size_t align)
+{
+	if(mSlotSize == 0)
+	{
+		mSlotSize = bytes;
+		mSlotOffset = slotOffset(align);
+		mChunkBytes = chunkBytes(bytes, align);
+	}
+	char* slot;
+	if(mFree != NIL)
+	{
+		slot = mChunks[mFree >> CHUNK_SHIFT] + mSlotOffset + (mFree & CHUNK_MASK) * mSlotSize;
+		std::memcpy(&mFree, slot, sizeof(mFree));
+	}
+	else
+	{
+		if(mNext == NIL) throw std::bad_alloc();
+		if((mNext >> CHUNK_SHIFT) == mChunks.size())
+		{
+			//make room first, so a chunk is never allocated without a place to record it
+			if(mChunks.size() == mChunks.capacity()) mChunks.reserve(2 * mChunks.size() + 1);
+			char* chunk = static_cast<char*>(allocateChunk(mChunkBytes));
+			ChunkHeader* header = reinterpret_cast<ChunkHeader*>(chunk);
+			header->pool = this;
+			header->number = static_cast<uint32_t>(mChunks.size());
+			mChunks.push_back(chunk);
+		}
+		slot = mChunks[mNext >> CHUNK_SHIFT] + mSlotOffset + (mNext & CHUNK_MASK) * mSlotSize;
+		mNext++;
+	}
+	mUsed++;
+	return slot;
+}
+
+inline void IndexPool::deallocate(void* slot)
+{
+	char* chunk = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(slot) & ~(mChunkBytes - 1));
+	uint32_t number = reinterpret_cast<ChunkHeader*>(chunk)->number;
+	std::memcpy(slot, &mFree, sizeof(mFree));
+	mFree = (number << CHUNK_SHIFT) | static_cast<uint32_t>((static_cast<char*>(slot) - chunk - mSlotOffset) / mSlotSize);
+	mUsed--;
+}
+
+/**
+* Frees every chunk. Any object still living in the pool is gone afterwards, so callers must only do
+* this when they own everything in it.
+*/
+inline void IndexPool::release()
+{
+	for(std::size_t i = 0; i < mChunks.size(); i++) freeChunk(mChunks[i], mChunkBytes);
+	mChunks.clear();
+	mNext = 0;
+	mFree = NIL;
+	mUsed = 0;
+}
+
+//number of slots in use
+inline std::size_t IndexPool::size() const
+{
+	return mUsed;
+}
+
+/**
+* The object at index in the pool that from lives in. A slot in from's own chunk is found from the chunk
+* header alone; any other goes through the pool's chunk table.
+*/
+template <typename T>
+T* IndexPool::at(const T* from, uint32_t index)
+{
+	constexpr std::size_t bytes = chunkBytes(sizeof(T), alignof(T));
+	const ChunkHeader* header = reinterpret_cast<const ChunkHeader*>(reinterpret_cast<uintptr_t>(from) & ~(bytes - 1));
+	uint32_t number = index >> CHUNK_SHIFT;
+	const char* chunk = number == header->number ? reinterpret_cast<const char*>(header) : header->pool->mChunks[number];
+	return reinterpret_cast<T*>(const_cast<char*>(chunk) + slotOffset(alignof(T)) + (index & CHUNK_MASK) * sizeof(T));
+}
+
+//the index of the slot an object lives in
+template <typename T>
+uint32_t IndexPool::indexOf(const T* slot)
+{
+	constexpr std::size_t bytes = chunkBytes(sizeof(T), alignof(T));
+	const char* chunk = reinterpret_cast<const char*>(reinterpret_cast<uintptr_t>(slot) & ~(bytes - 1));
+	uint32_t number = reinterpret_cast<const ChunkHeader*>(chunk)->number;
+	return (number << CHUNK_SHIFT)
+		| static_cast<uint32_t>((reinterpret_cast<const char*>(slot) - chunk - slotOffset(alignof(T))) / sizeof(T));
+}
+
+/*
+	-------------------------------------------
+	End implementations for the IndexPool class.
+	-------------------------------------------
+*/
+
+/*
+	-----------------------------------------------------
+	Begin implementations for the IndexedSplayNode class.
+	-----------------------------------------------------
+*/
+
+/**
+* Explicit constructor for a node, which must be built in a slot of an IndexPool.
+*/
+template<typename Key, typename Value>
+IndexedSplayNode<Key, Value>::IndexedSplayNode(const Key& key, const Value& value, IndexedSplayNode<Key, Value>* parent)
+	: mItem(key, value)
+	, mParent(toIndex(parent))
+	, mLeft(IndexPool::NIL)
+	, mRight(IndexPool::NIL)
+{
+
+}
+
+template<typename Key, typename Value>
+const std::pair<const Key, Value>& IndexedSplayNode<Key, Value>::getItem() const
+{
+	return mItem;
+}
+
+template<typename Key, typename Value>
+std::pair<const Key, Value>& IndexedSplayNode<Key, Value>::getItem()
+{
+	return mItem;
+}
+
+template<typename Key, typename Value>
+const Key& IndexedSplayNode<Key, Value>::getKey() const
+{
+	return mItem.first;
+}
+
+template<typename Key, typename Value>
+const Value& IndexedSplayNode<Key, Value>::getValue() const
+{
+	return mItem.second;
+}
+
+template<typename Key, typename Value>
+Value& IndexedSplayNode<Key, Value>::getValue()
+{
+	return mItem.second;
+}
+
+template<typename Key, typename Value>
+IndexedSplayNode<Key, Value>* IndexedSplayNode<Key, Value>::getParent() const
+{
+	return toNode(mParent);
+}
+
+template<typename Key, typename Value>
+IndexedSplayNode<Key, Value>* IndexedSplayNode<Key, Value>::getLeft() const
+{
+	return toNode(mLeft);
+}
+
+template<typename Key, typename Value>
+IndexedSplayNode<Key, Value>* IndexedSplayNode<Key, Value>::getRight() const
+{
+	return toNode(mRight);
+}
+
+template<typename Key, typename Value>
+void IndexedSplayNode<Key, Value>::setParent(IndexedSplayNode<Key, Value>* parent)
+{
+	mParent = toIndex(parent);
+}
+
+template<typename Key, typename Value>
+void IndexedSplayNode<Key, Value>::setLeft(IndexedSplayNode<Key, Value>* left)
+{
+	mLeft = toIndex(left);
+}
+
+template<typename Key, typename Value>
+void IndexedSplayNode<Key, Value>::setRight(IndexedSplayNode<Key, Value>* right)
+{
+	mRight = toIndex(right);
+}
+
+//see NodeBase::setKey
+template<typename Key, typename Value>
+void IndexedSplayNode<Key, Value>::setKey(const Key& key)
+{
+	const_cast<Key&>(mItem.first) = key;
+}
+
+template<typename Key, typename Value>
+void IndexedSplayNode<Key, Value>::setValue(const Value& value)
+{
+	mItem.second = value;
+}
+
+//splay nodes cache nothing about their subtree
+template<typename Key, typename Value>
+void IndexedSplayNode<Key, Value>::recompute()
+{
+
+}
+
+//nor keep any balancing state
+template<typename Key, typename Value>
+void IndexedSplayNode<Key, Value>::copyBalance(const IndexedSplayNode<Key, Value>&)
+{
+
+}
+
+//links are resolved in the pool this node lives in
+template<typename Key, typename Value>
+IndexedSplayNode<Key, Value>* IndexedSplayNode<Key, Value>::toNode(uint32_t index) const
+{
+	if(index == IndexPool::NIL) return nullptr;
+	return IndexPool::at(this, index);
+}
+
+template<typename Key, typename Value>
+uint32_t IndexedSplayNode<Key, Value>::toIndex(const IndexedSplayNode<Key, Value>* node)
+{
+	if(node == nullptr) return IndexPool::NIL;
+	return IndexPool::indexOf(node);
+}
+
+/*
+	---------------------------------------------------
+	End implementations for the IndexedSplayNode class.
+	---------------------------------------------------
+*/
+
+/*
+	-------------------------------------------------------
+	Begin implementations for the IndexPoolAllocator class.
+	-------------------------------------------------------
+*/
+
+template <typename T>
+IndexPoolAllocator<T>::IndexPoolAllocator()
+	: mPool(std::make_shared<IndexPool>())
+{
+
+}
+
+template <typename T>
+template <typename U>
+IndexPoolAllocator<T>::IndexPoolAllocator(const IndexPoolAllocator<U>& other)
+	: mPool(other.mPool)
+{
+
+}
+
+template <typename T>
+T* IndexPoolAllocator<T>::allocate(std::size_t n)
+{
+	if(n == 1 && mPool->owns(sizeof(T))) return static_cast<T*>(mPool->allocate(sizeof(T), alignof(T)));
+	return static_cast<T*>(::operator new(n * sizeof(T)));
+}
+
+template <typename T>
+void IndexPoolAllocator<T>::deallocate(T* p, std::size_t n)
+{
+	if(n == 1 && mPool->owns(sizeof(T))) mPool->deallocate(p);
+	else ::operator delete(p);
+}
+
+/**
+* Drops every chunk of the pool if this allocator is its only user, and reports whether it did.
+*/
+template <typename T>
+bool IndexPoolAllocator<T>::release()
+{
+	if(mPool.use_count() != 1) return false;
+	mPool->release();
+	return true;
+}
+
+//a copied tree gets a pool of its own rather than sharing the original's
+template <typename T>
+IndexPoolAllocator<T> IndexPoolAllocator<T>::select_on_container_copy_construction() const
+{
+	return IndexPoolAllocator<T>();
+}
+
+template <typename T>
+template <typename U>
+bool IndexPoolAllocator<T>::operator==(const IndexPoolAllocator<U>& rhs) const
+{
+	return mPool == rhs.mPool;
+}
+
+template <typename T>
+template <typename U>
+bool IndexPoolAllocator<T>::operator!=(const IndexPoolAllocator<U>& rhs) const
+{
+	return mPool != rhs.mPool;
+}
+
+/*
+	-----------------------------------------------------
+	End implementations for the IndexPoolAllocator class.
+	-----------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,34 @@
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include "splayTree.h"
+
+//multiFind on trees too small to give every lane a step; these used to hang
+int main()
+{
+	std::vector<int> keys;
+	keys.push_back(1);
+	keys.push_back(2);
+	keys.push_back(3);
+
+	SplayTree<int, int> empty;
+	std::vector<SplayTree<int, int>::iterator> out(keys.size());
+	empty.multiFind(keys.begin(), keys.end(), out.begin());
+	for(std::size_t i = 0; i < out.size(); i++) assert(out[i] == empty.end());
+	empty.multiFind(keys.begin(), keys.end(), out.begin(), true);
+	for(std::size_t i = 0; i < out.size(); i++) assert(out[i] == empty.end());
+
+	SplayTree<int, int> single;
+	single.insert(std::make_pair(2, 20));
+	single.multiFind(keys.begin(), keys.end(), out.begin());
+	assert(out[0] == single.end());
+	assert(out[1] != single.end() && out[1]->first == 2 && out[1]->second == 20);
+	assert(out[2] == single.end());
+	single.multiFind(keys.begin(), keys.end(), out.begin(), true);
+	assert(out[0] == single.end());
+	assert(out[1] != single.end() && out[1]->first == 2);
+	assert(out[2] == single.end());
+
+	std::cout << "multiFind: ok" << std::endl;
+	return 0;
+}
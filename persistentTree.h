@@ -0,0 +1,859 @@
+#ifndef PERSISTENT_TREE_H
+#define PERSISTENT_TREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+* The node layout used by PersistentTree: the item, two links (no parent, so that subtrees can be shared
+* between versions), the AVL height, the subtree size, and the number of the write that created the
+* node. A node is only ever changed by the write that created it, before that write is published.
+*/
+template <typename Key, typename Value>
+class PersistentNode
+{
+public:
+	PersistentNode(const std::pair<const Key, Value>& item, PersistentNode<Key, Value>* left, PersistentNode<Key, Value>* right, std::uint64_t birth);
+
+	const std::pair<const Key, Value>& getItem() const;
+	const Key& getKey() const;
+	PersistentNode<Key, Value>* getLeft() const;
+	PersistentNode<Key, Value>* getRight() const;
+	int getHeight() const;
+	std::size_t getSize() const;
+	std::uint64_t getBirth() const;
+
+	void setValue(const Value& value);
+	void setLeft(PersistentNode<Key, Value>* left);
+	void setRight(PersistentNode<Key, Value>* right);
+	void recompute();
+
+protected:
+	std::pair<const Key, Value> mItem;
+	PersistentNode<Key, Value>* mLeft;
+	PersistentNode<Key, Value>* mRight;
+	int mHeight;
+	std::size_t mSize;
+	std::uint64_t mBirth;
+};
+
+/**
+* A balanced search tree that readers can query from any number of threads without locks while writers
+* keep changing it. Writes copy the path they change instead of touching published nodes, so every
+* version of the tree stays intact; the new root is then published with one atomic store. A reader takes
+* a Snapshot, which pins the current version, and does plain (non-splaying) lookups and in-order
+* iteration on it for as long as it likes.
+*
+* Replaced nodes are reclaimed by epochs: each snapshot occupies a reader slot holding the epoch it
+* started in, and a node retired in epoch e is freed by a later write once no slot holds an epoch before
+* e. Taking a snapshot costs a compare-and-swap on a slot that no other reader is using, so at most
+* READER_SLOTS snapshots can be open at once; snapshot() throws std::length_error rather than wait for a
+* slot that its own thread may be holding. Writers are serialized by a mutex among themselves and never
+* wait for readers. A write that throws leaves the tree as it was. Snapshots must be released before the
+* tree is destroyed.
+*/
+template <typename Key, typename Value, typename Alloc = std::allocator<std::pair<const Key, Value> >,
+	typename Compare = std::less<Key> >
+class PersistentTree
+{
+public:
+	typedef PersistentNode<Key, Value> NodeType;
+	typedef Alloc allocator_type;
+	typedef Compare key_compare;
+
+	static const std::size_t READER_SLOTS = 64;
+
+	/**
+	* A consistent read-only view of the tree as it was when the snapshot was taken. Movable, not
+	* copyable; the version is released when the snapshot is destroyed.
+	*/
+	class Snapshot
+	{
+		public:
+			/**
+			* A forward iterator over the items of the snapshot in key order. It carries the path from
+			* the root, since nodes have no parent links.
+			*/
+			class const_iterator
+			{
+				public:
+					typedef std::forward_iterator_tag iterator_category;
+					typedef std::pair<const Key, Value> value_type;
+					typedef std::ptrdiff_t difference_type;
+					typedef const std::pair<const Key, Value>* pointer;
+					typedef const std::pair<const Key, Value>& reference;
+
+					const_iterator();
+					explicit const_iterator(const NodeType* root);
+
+					const std::pair<const Key, Value>& operator*() const;
+					const std::pair<const Key, Value>* operator->() const;
+
+					bool operator==(const const_iterator& rhs) const;
+					bool operator!=(const const_iterator& rhs) const;
+
+					const_iterator& operator++();
+					const_iterator operator++(int);
+
+				protected:
+					void pushLeft(const NodeType* node);
+
+					std::vector<const NodeType*> mPath;
+			};
+
+			Snapshot(Snapshot&& other);
+			Snapshot(const Snapshot& other) = delete;
+			Snapshot& operator=(const Snapshot& other) = delete;
+			~Snapshot();
+
+			const Value* find(const Key& key) const;
+			bool contains(const Key& key) const;
+			std::size_t size() const;
+			bool empty() const;
+			const_iterator begin() const;
+			const_iterator end() const;
+			template <typename Callback>
+			void scan(const Key& lo, const Key& hi, Callback callback) const;
+
+		protected:
+			friend class PersistentTree<Key, Value, Alloc, Compare>;
+			Snapshot(const PersistentTree<Key, Value, Alloc, Compare>* tree, std::size_t slot, const NodeType* root);
+
+			const PersistentTree<Key, Value, Alloc, Compare>* mTree;
+			std::size_t mSlot;
+			const NodeType* mRoot;
+	};
+
+	explicit PersistentTree(const Alloc& alloc = Alloc());
+	explicit PersistentTree(const Compare& comp, const Alloc& alloc = Alloc());
+	PersistentTree(const PersistentTree<Key, Value, Alloc, Compare>& other) = delete;
+	PersistentTree<Key, Value, Alloc, Compare>& operator=(const PersistentTree<Key, Value, Alloc, Compare>& other) = delete;
+	~PersistentTree();
+
+	void insert(const std::pair<const Key, Value>& keyValuePair);
+	void remove(const Key& key);
+	Snapshot snapshot() const;
+	std::size_t size() const;
+	Compare key_comp() const;
+	Alloc get_allocator() const;
+
+protected:
+	typedef typename std::allocator_traits<Alloc>::template rebind_alloc<NodeType> NodeAllocator;
+	typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+
+	//padded to a cache line each, so that readers on neighbouring slots do not keep stealing it
+	struct ReaderSlot
+	{
+		std::atomic<std::uint64_t> mEpoch;
+		char mPadding[64 - sizeof(std::atomic<std::uint64_t>)];
+	};
+
+	//the nodes one write replaced, which readers of earlier epochs may still be looking at
+	struct RetiredBatch
+	{
+		std::uint64_t mEpoch;
+		std::vector<NodeType*> mNodes;
+	};
+
+	static const std::uint64_t FREE_SLOT = 0;
+
+	NodeType* createNode(const std::pair<const Key, Value>& item, NodeType* left, NodeType* right);
+	void destroyNode(NodeType* node);
+	NodeType* own(NodeType* node);
+	void discard(NodeType* node);
+	static int heightOf(const NodeType* node);
+	NodeType* rotateLeft(NodeType* node);
+	NodeType* rotateRight(NodeType* node);
+	NodeType* balance(NodeType* node);
+	NodeType* insertAt(NodeType* node, const std::pair<const Key, Value>& keyValuePair);
+	NodeType* removeAt(NodeType* node, const Key& key);
+	NodeType* removeMin(NodeType* node, NodeType** min);
+	static const NodeType* findNode(const NodeType* root, const Key& key, const Compare& comp);
+	void publish(NodeType* root);
+	void rollback();
+	void reclaim();
+	void releaseSlot(std::size_t slot) const;
+
+	NodeAllocator mAlloc;
+	Compare mCompare;
+	std::atomic<NodeType*> mRoot;
+	std::atomic<std::uint64_t> mEpoch;
+	mutable ReaderSlot mSlots[READER_SLOTS];
+	std::mutex mWriteLock;
+	std::uint64_t mWrites;
+	std::vector<NodeType*> mReplaced;
+	std::vector<NodeType*> mCreated;
+	std::deque<RetiredBatch> mRetired;
+};
+
+/*
+	---------------------------------------------------
+	Begin implementations for the PersistentNode class.
+	---------------------------------------------------
+*/
+
+template <typename Key, typename Value>
+PersistentNode<Key, Value>::PersistentNode(const std::pair<const Key, Value>& item, PersistentNode<Key, Value>* left, PersistentNode<Key, Value>* right, std::uint64_t birth)
+	: mItem(item)
+	, mLeft(left)
+	, mRight(right)
+	, mBirth(birth)
+{
+	recompute();
+}
+
+template <typename Key, typename Value>
+const std::pair<const Key, Value>& PersistentNode<Key, Value>::getItem() const
+{
+	return mItem;
+}
+
+template <typename Key, typename Value>
+const Key& PersistentNode<Key, Value>::getKey() const
+{
+	return mItem.first;
+}
+
+template <typename Key, typename Value>
+PersistentNode<Key, Value>* PersistentNode<Key, Value>::getLeft() const
+{
+	return mLeft;
+}
+
+template <typename Key, typename Value>
+PersistentNode<Key, Value>* PersistentNode<Key, Value>::getRight() const
+{
+	return mRight;
+}
+
+template <typename Key, typename Value>
+int PersistentNode<Key, Value>::getHeight() const
+{
+	return mHeight;
+}
+
+template <typename Key, typename Value>
+std::size_t PersistentNode<Key, Value>::getSize() const
+{
+	return mSize;
+}
+
+template <typename Key, typename Value>
+std::uint64_t PersistentNode<Key, Value>::getBirth() const
+{
+	return mBirth;
+}
+
+template <typename Key, typename Value>
+void PersistentNode<Key, Value>::setValue(const Value& value)
+{
+	mItem.second = value;
+}
+
+template <typename Key, typename Value>
+void PersistentNode<Key, Value>::setLeft(PersistentNode<Key, Value>* left)
+{
+	mLeft = left;
+}
+
+template <typename Key, typename Value>
+void PersistentNode<Key, Value>::setRight(PersistentNode<Key, Value>* right)
+{
+	mRight = right;
+}
+
+//height and size from the children
+template <typename Key, typename Value>
+void PersistentNode<Key, Value>::recompute()
+{
+	int left = mLeft != nullptr ? mLeft->mHeight : 0;
+	int right = mRight != nullptr ? mRight->mHeight : 0;
+	mHeight = std::max(left, right) + 1;
+	mSize = 1 + (mLeft != nullptr ? mLeft->mSize : 0) + (mRight != nullptr ? mRight->mSize : 0);
+}
+
+/*
+	-------------------------------------------------
+	End implementations for the PersistentNode class.
+	-------------------------------------------------
+*/
+
+/*
+	----------------------------------------------------------------------------
+	Begin implementations for the PersistentTree::Snapshot::const_iterator class.
+	----------------------------------------------------------------------------
+*/
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator::const_iterator()
+{
+
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator::const_iterator(const NodeType* root)
+{
+	pushLeft(root);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+const std::pair<const Key, Value>& PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator::operator*() const
+{
+	return mPath.back()->getItem();
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+const std::pair<const Key, Value>* PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator::operator->() const
+{
+	return &(mPath.back()->getItem());
+}
+
+//two iterators are at the same item when their paths end on the same node, and both ended when empty
+template <typename Key, typename Value, typename Alloc, typename Compare>
+bool PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator::operator==(const const_iterator& rhs) const
+{
+	if(mPath.empty() || rhs.mPath.empty()) return mPath.empty() == rhs.mPath.empty();
+	return mPath.back() == rhs.mPath.back();
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+bool PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator::operator!=(const const_iterator& rhs) const
+{
+	return !(*this == rhs);
+}
+
+/**
+* The path holds the current node and the ancestors still to be visited, so the next item is the
+* leftmost node of the right subtree, or else the nearest such ancestor.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator& PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator::operator++()
+{
+	const NodeType* node = mPath.back();
+	mPath.pop_back();
+	pushLeft(node->getRight());
+	return *this;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator::operator++(int)
+{
+	const_iterator old(*this);
+	++*this;
+	return old;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+void PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator::pushLeft(const NodeType* node)
+{
+	for(; node != nullptr; node = node->getLeft()) mPath.push_back(node);
+}
+
+/*
+	--------------------------------------------------------------------------
+	End implementations for the PersistentTree::Snapshot::const_iterator class.
+	--------------------------------------------------------------------------
+*/
+
+/*
+	------------------------------------------------------------
+	Begin implementations for the PersistentTree::Snapshot class.
+	------------------------------------------------------------
+*/
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+PersistentTree<Key, Value, Alloc, Compare>::Snapshot::Snapshot(const PersistentTree<Key, Value, Alloc, Compare>* tree, std::size_t slot, const NodeType* root)
+	: mTree(tree)
+	, mSlot(slot)
+	, mRoot(root)
+{
+
+}
+
+//the moved-from snapshot no longer holds the slot
+template <typename Key, typename Value, typename Alloc, typename Compare>
+PersistentTree<Key, Value, Alloc, Compare>::Snapshot::Snapshot(Snapshot&& other)
+	: mTree(other.mTree)
+	, mSlot(other.mSlot)
+	, mRoot(other.mRoot)
+{
+	other.mTree = nullptr;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+PersistentTree<Key, Value, Alloc, Compare>::Snapshot::~Snapshot()
+{
+	if(mTree != nullptr) mTree->releaseSlot(mSlot);
+}
+
+/**
+* Returns a pointer to the value stored under key in this version, or nullptr if the key is missing. The
+* pointer stays valid as long as the snapshot.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+const Value* PersistentTree<Key, Value, Alloc, Compare>::Snapshot::find(const Key& key) const
+{
+	const NodeType* node = findNode(mRoot, key, mTree->mCompare);
+	return node != nullptr ? &node->getItem().second : nullptr;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+bool PersistentTree<Key, Value, Alloc, Compare>::Snapshot::contains(const Key& key) const
+{
+	return findNode(mRoot, key, mTree->mCompare) != nullptr;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+std::size_t PersistentTree<Key, Value, Alloc, Compare>::Snapshot::size() const
+{
+	return mRoot != nullptr ? mRoot->getSize() : 0;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+bool PersistentTree<Key, Value, Alloc, Compare>::Snapshot::empty() const
+{
+	return mRoot == nullptr;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator PersistentTree<Key, Value, Alloc, Compare>::Snapshot::begin() const
+{
+	return const_iterator(mRoot);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::Snapshot::const_iterator PersistentTree<Key, Value, Alloc, Compare>::Snapshot::end() const
+{
+	return const_iterator();
+}
+
+/**
+* Calls callback with every item whose key k has lo <= k < hi, in key order. Subtrees entirely outside
+* the range are skipped, so the cost is O(log n) plus the number of items.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+template <typename Callback>
+void PersistentTree<Key, Value, Alloc, Compare>::Snapshot::scan(const Key& lo, const Key& hi, Callback callback) const
+{
+	const Compare& comp = mTree->mCompare;
+	std::vector<const NodeType*> path;
+	const NodeType* node = mRoot;
+	while(node != nullptr || !path.empty())
+	{
+		//descend left while the node is in range, otherwise skip its left subtree
+		while(node != nullptr)
+		{
+			if(comp(node->getKey(), lo)) node = node->getRight();
+			else
+			{
+				path.push_back(node);
+				node = node->getLeft();
+			}
+		}
+		if(path.empty()) break;
+		node = path.back();
+		path.pop_back();
+		if(!comp(node->getKey(), hi)) break;
+		callback(node->getItem());
+		node = node->getRight();
+	}
+}
+
+/*
+	----------------------------------------------------------
+	End implementations for the PersistentTree::Snapshot class.
+	----------------------------------------------------------
+*/
+
+/*
+	---------------------------------------------------
+	Begin implementations for the PersistentTree class.
+	---------------------------------------------------
+*/
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+PersistentTree<Key, Value, Alloc, Compare>::PersistentTree(const Alloc& alloc)
+	: mAlloc(alloc)
+	, mCompare()
+	, mRoot(nullptr)
+	, mEpoch(1)
+	, mWrites(0)
+{
+	for(std::size_t i = 0; i < READER_SLOTS; i++) mSlots[i].mEpoch.store(FREE_SLOT);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+PersistentTree<Key, Value, Alloc, Compare>::PersistentTree(const Compare& comp, const Alloc& alloc)
+	: mAlloc(alloc)
+	, mCompare(comp)
+	, mRoot(nullptr)
+	, mEpoch(1)
+	, mWrites(0)
+{
+	for(std::size_t i = 0; i < READER_SLOTS; i++) mSlots[i].mEpoch.store(FREE_SLOT);
+}
+
+//frees the current version and everything still waiting to be reclaimed, without recursion
+template <typename Key, typename Value, typename Alloc, typename Compare>
+PersistentTree<Key, Value, Alloc, Compare>::~PersistentTree()
+{
+	std::vector<NodeType*> pending;
+	if(mRoot.load() != nullptr) pending.push_back(mRoot.load());
+	while(!pending.empty())
+	{
+		NodeType* node = pending.back();
+		pending.pop_back();
+		if(node->getLeft() != nullptr) pending.push_back(node->getLeft());
+		if(node->getRight() != nullptr) pending.push_back(node->getRight());
+		destroyNode(node);
+	}
+	for(typename std::deque<RetiredBatch>::iterator it = mRetired.begin(); it != mRetired.end(); ++it)
+	{
+		for(std::size_t i = 0; i < it->mNodes.size(); i++) destroyNode(it->mNodes[i]);
+	}
+}
+
+/**
+* Inserts a key/value pair, or overwrites the value if the key is already present, and publishes the new
+* version. Copies the O(log n) nodes on the path; snapshots taken earlier do not see the change.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+void PersistentTree<Key, Value, Alloc, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+	std::lock_guard<std::mutex> lock(mWriteLock);
+	mWrites++;
+	try
+	{
+		publish(insertAt(mRoot.load(), keyValuePair));
+	}
+	catch(...)
+	{
+		rollback();
+		throw;
+	}
+}
+
+/**
+* Removes a key if it is present and publishes the new version. Removing a missing key copies nothing.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+void PersistentTree<Key, Value, Alloc, Compare>::remove(const Key& key)
+{
+	std::lock_guard<std::mutex> lock(mWriteLock);
+	NodeType* root = mRoot.load();
+	if(findNode(root, key, mCompare) == nullptr) return;
+	mWrites++;
+	try
+	{
+		publish(removeAt(root, key));
+	}
+	catch(...)
+	{
+		rollback();
+		throw;
+	}
+}
+
+/**
+* Pins the current version and returns a snapshot of it. The snapshot claims a free reader slot with the
+* current epoch and only then reads the root, so any write that retires nodes of this version afterwards
+* sees the slot. Throws std::length_error if all READER_SLOTS are taken.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::Snapshot PersistentTree<Key, Value, Alloc, Compare>::snapshot() const
+{
+	//start from a slot that depends on the thread, so that readers rarely contend for the same one
+	std::size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % READER_SLOTS;
+	for(std::size_t i = 0; i < READER_SLOTS; i++)
+	{
+		std::size_t slot = (start + i) % READER_SLOTS;
+		std::uint64_t expected = FREE_SLOT;
+		if(mSlots[slot].mEpoch.load(std::memory_order_relaxed) != FREE_SLOT) continue;
+		if(mSlots[slot].mEpoch.compare_exchange_strong(expected, mEpoch.load()))
+		{
+			return Snapshot(this, slot, mRoot.load());
+		}
+	}
+	throw std::length_error("PersistentTree: all reader slots are taken");
+}
+
+//the size of the latest version
+template <typename Key, typename Value, typename Alloc, typename Compare>
+std::size_t PersistentTree<Key, Value, Alloc, Compare>::size() const
+{
+	NodeType* root = mRoot.load();
+	return root != nullptr ? root->getSize() : 0;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+Compare PersistentTree<Key, Value, Alloc, Compare>::key_comp() const
+{
+	return mCompare;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+Alloc PersistentTree<Key, Value, Alloc, Compare>::get_allocator() const
+{
+	return Alloc(mAlloc);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::NodeType* PersistentTree<Key, Value, Alloc, Compare>::createNode(const std::pair<const Key, Value>& item, NodeType* left, NodeType* right)
+{
+	NodeType* node = NodeAllocatorTraits::allocate(mAlloc, 1);
+	try
+	{
+		NodeAllocatorTraits::construct(mAlloc, node, item, left, right, mWrites);
+	}
+	catch(...)
+	{
+		NodeAllocatorTraits::deallocate(mAlloc, node, 1);
+		throw;
+	}
+	//remembered until the write is published, so that a write that throws can free it
+	try
+	{
+		mCreated.push_back(node);
+	}
+	catch(...)
+	{
+		destroyNode(node);
+		throw;
+	}
+	return node;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+void PersistentTree<Key, Value, Alloc, Compare>::destroyNode(NodeType* node)
+{
+	NodeAllocatorTraits::destroy(mAlloc, node);
+	NodeAllocatorTraits::deallocate(mAlloc, node, 1);
+}
+
+/**
+* Returns a node the current write may change: node itself if this write created it, otherwise a copy,
+* with node set aside to be retired once the write is published.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::NodeType* PersistentTree<Key, Value, Alloc, Compare>::own(NodeType* node)
+{
+	if(node->getBirth() == mWrites) return node;
+	NodeType* copy = createNode(node->getItem(), node->getLeft(), node->getRight());
+	mReplaced.push_back(node);
+	return copy;
+}
+
+//drops a node from the version being built: freed now if no reader can have seen it, retired otherwise
+template <typename Key, typename Value, typename Alloc, typename Compare>
+void PersistentTree<Key, Value, Alloc, Compare>::discard(NodeType* node)
+{
+	if(node->getBirth() == mWrites)
+	{
+		mCreated.erase(std::find(mCreated.begin(), mCreated.end(), node));
+		destroyNode(node);
+	}
+	else mReplaced.push_back(node);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+int PersistentTree<Key, Value, Alloc, Compare>::heightOf(const NodeType* node)
+{
+	return node == nullptr ? 0 : node->getHeight();
+}
+
+//node must already be owned; its right child is copied if need be
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::NodeType* PersistentTree<Key, Value, Alloc, Compare>::rotateLeft(NodeType* node)
+{
+	NodeType* right = own(node->getRight());
+	node->setRight(right->getLeft());
+	node->recompute();
+	right->setLeft(node);
+	right->recompute();
+	return right;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::NodeType* PersistentTree<Key, Value, Alloc, Compare>::rotateRight(NodeType* node)
+{
+	NodeType* left = own(node->getLeft());
+	node->setLeft(left->getRight());
+	node->recompute();
+	left->setRight(node);
+	left->recompute();
+	return left;
+}
+
+/**
+* Restores the AVL balance at an owned node whose subtrees differ in height by at most two, and returns
+* the root of the subtree.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::NodeType* PersistentTree<Key, Value, Alloc, Compare>::balance(NodeType* node)
+{
+	node->recompute();
+	int diff = heightOf(node->getLeft()) - heightOf(node->getRight());
+	if(diff > 1)
+	{
+		NodeType* left = node->getLeft();
+		if(heightOf(left->getLeft()) < heightOf(left->getRight())) node->setLeft(rotateLeft(own(left)));
+		return rotateRight(node);
+	}
+	if(diff < -1)
+	{
+		NodeType* right = node->getRight();
+		if(heightOf(right->getRight()) < heightOf(right->getLeft())) node->setRight(rotateRight(own(right)));
+		return rotateLeft(node);
+	}
+	return node;
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::NodeType* PersistentTree<Key, Value, Alloc, Compare>::insertAt(NodeType* node, const std::pair<const Key, Value>& keyValuePair)
+{
+	if(node == nullptr) return createNode(keyValuePair, nullptr, nullptr);
+	node = own(node);
+	if(mCompare(keyValuePair.first, node->getKey())) node->setLeft(insertAt(node->getLeft(), keyValuePair));
+	else if(mCompare(node->getKey(), keyValuePair.first)) node->setRight(insertAt(node->getRight(), keyValuePair));
+	else
+	{
+		node->setValue(keyValuePair.second);
+		return node;
+	}
+	return balance(node);
+}
+
+/**
+* Removes key, which must be in the subtree. A node with two children is replaced by a new node holding
+* its successor's item.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::NodeType* PersistentTree<Key, Value, Alloc, Compare>::removeAt(NodeType* node, const Key& key)
+{
+	if(mCompare(key, node->getKey()))
+	{
+		node = own(node);
+		node->setLeft(removeAt(node->getLeft(), key));
+		return balance(node);
+	}
+	if(mCompare(node->getKey(), key))
+	{
+		node = own(node);
+		node->setRight(removeAt(node->getRight(), key));
+		return balance(node);
+	}
+	NodeType* left = node->getLeft();
+	NodeType* right = node->getRight();
+	discard(node);
+	if(left == nullptr) return right;
+	if(right == nullptr) return left;
+	NodeType* min;
+	right = removeMin(right, &min);
+	NodeType* replacement = createNode(min->getItem(), left, right);
+	discard(min);
+	return balance(replacement);
+}
+
+//unhooks the smallest node of the subtree, which the caller discards, and returns the rest
+template <typename Key, typename Value, typename Alloc, typename Compare>
+typename PersistentTree<Key, Value, Alloc, Compare>::NodeType* PersistentTree<Key, Value, Alloc, Compare>::removeMin(NodeType* node, NodeType** min)
+{
+	if(node->getLeft() == nullptr)
+	{
+		*min = node;
+		return node->getRight();
+	}
+	node = own(node);
+	node->setLeft(removeMin(node->getLeft(), min));
+	return balance(node);
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+const typename PersistentTree<Key, Value, Alloc, Compare>::NodeType* PersistentTree<Key, Value, Alloc, Compare>::findNode(const NodeType* root, const Key& key, const Compare& comp)
+{
+	const NodeType* node = root;
+	while(node != nullptr)
+	{
+		if(comp(key, node->getKey())) node = node->getLeft();
+		else if(comp(node->getKey(), key)) node = node->getRight();
+		else return node;
+	}
+	return nullptr;
+}
+
+/**
+* Makes root the current version, then moves the epoch on: a snapshot that pins the new epoch reads the
+* root after this store and cannot reach the replaced nodes, which are retired under the new epoch. The
+* batch is queued before the store, so nothing can throw once the version is visible.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+void PersistentTree<Key, Value, Alloc, Compare>::publish(NodeType* root)
+{
+	bool retiring = !mReplaced.empty();
+	if(retiring)
+	{
+		mRetired.push_back(RetiredBatch());
+		mRetired.back().mNodes.swap(mReplaced);
+	}
+	mRoot.store(root);
+	std::uint64_t epoch = mEpoch.fetch_add(1) + 1;
+	if(retiring) mRetired.back().mEpoch = epoch;
+	mCreated.clear();
+	reclaim();
+}
+
+/**
+* Undoes a write that threw before it was published: the nodes it created are reachable from no version
+* and are freed, and the published nodes it meant to replace stay where they are.
+*/
+template <typename Key, typename Value, typename Alloc, typename Compare>
+void PersistentTree<Key, Value, Alloc, Compare>::rollback()
+{
+	for(std::size_t i = 0; i < mCreated.size(); i++) destroyNode(mCreated[i]);
+	mCreated.clear();
+	mReplaced.clear();
+}
+
+//frees the retired batches that no pinned snapshot can still reach
+template <typename Key, typename Value, typename Alloc, typename Compare>
+void PersistentTree<Key, Value, Alloc, Compare>::reclaim()
+{
+	if(mRetired.empty()) return;
+	std::uint64_t oldest = mEpoch.load();
+	for(std::size_t i = 0; i < READER_SLOTS; i++)
+	{
+		std::uint64_t pinned = mSlots[i].mEpoch.load();
+		if(pinned != FREE_SLOT && pinned < oldest) oldest = pinned;
+	}
+	while(!mRetired.empty() && mRetired.front().mEpoch <= oldest)
+	{
+		std::vector<NodeType*>& nodes = mRetired.front().mNodes;
+		for(std::size_t i = 0; i < nodes.size(); i++) destroyNode(nodes[i]);
+		mRetired.pop_front();
+	}
+}
+
+template <typename Key, typename Value, typename Alloc, typename Compare>
+void PersistentTree<Key, Value, Alloc, Compare>::releaseSlot(std::size_t slot) const
+{
+	mSlots[slot].mEpoch.store(FREE_SLOT, std::memory_order_release);
+}
+
+/*
+	-------------------------------------------------
+	End implementations for the PersistentTree class.
+	-------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,306 @@
+#ifndef RED_BLACK_TREE_H
+#define RED_BLACK_TREE_H
+
+#include "rotateBST.h"
+
+/**
+* The node layout used by RedBlackTree: the item, the links and the node's color. New nodes are red.
+*/
+template <typename Key, typename Value>
+class RedBlackNode : public NodeBase<Key, Value, RedBlackNode<Key, Value> >
+{
+public:
+	RedBlackNode(const Key& key, const Value& value, RedBlackNode<Key, Value>* parent);
+
+	bool isRed() const;
+	void setRed(bool red);
+	void copyBalance(const RedBlackNode<Key, Value>& other);
+
+protected:
+	bool mRed;
+};
+
+template <typename Key, typename Value>
+RedBlackNode<Key, Value>::RedBlackNode(const Key& key, const Value& value, RedBlackNode<Key, Value>* parent)
+	: NodeBase<Key, Value, RedBlackNode<Key, Value> >(key, value, parent)
+	, mRed(true)
+{
+
+}
+
+template <typename Key, typename Value>
+bool RedBlackNode<Key, Value>::isRed() const
+{
+	return mRed;
+}
+
+template <typename Key, typename Value>
+void RedBlackNode<Key, Value>::setRed(bool red)
+{
+	mRed = red;
+}
+
+//a copied tree keeps its colors, which the shape alone does not determine
+template <typename Key, typename Value>
+void RedBlackNode<Key, Value>::copyBalance(const RedBlackNode<Key, Value>& other)
+{
+	mRed = other.mRed;
+}
+
+/**
+* A red-black tree (Guibas and Sedgewick, following Cormen et al.). No path from the root is more than
+* twice as long as any other, so every lookup is O(log n) in the worst case, and an insert or remove does
+* at most three rotations. The interface is the same as SplayTree's, and lookups do not restructure the
+* tree.
+*/
+template <typename Key, typename Value, typename NodeType = RedBlackNode<Key, Value>,
+	typename Alloc = std::allocator<std::pair<const Key, Value> >, typename Compare = std::less<Key> >
+class RedBlackTree : public rotateBST<Key, Value, NodeType, Alloc, Compare>
+{
+public:
+	explicit RedBlackTree(const Alloc& alloc = Alloc());
+	explicit RedBlackTree(const Compare& comp, const Alloc& alloc = Alloc());
+	typename RedBlackTree<Key, Value, NodeType, Alloc, Compare>::iterator insert(const std::pair<const Key, Value>& keyValuePair);
+	void remove(const Key& key);
+	void deleteMinLeaf();
+protected:
+	static bool isRed(const NodeType* node);
+	void insertFixup(NodeType* node);
+	void eraseNode(NodeType* node);
+	void removeFixup(NodeType* node, NodeType* parent);
+private:
+	//these reshape the tree by rotations alone, which would leave the colors behind
+	using rotateBST<Key, Value, NodeType, Alloc, Compare>::transform;
+	using rotateBST<Key, Value, NodeType, Alloc, Compare>::rebalance;
+};
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+RedBlackTree<Key, Value, NodeType, Alloc, Compare>::RedBlackTree(const Alloc& alloc)
+	: rotateBST<Key, Value, NodeType, Alloc, Compare>(alloc)
+{
+
+}
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+RedBlackTree<Key, Value, NodeType, Alloc, Compare>::RedBlackTree(const Compare& comp, const Alloc& alloc)
+	: rotateBST<Key, Value, NodeType, Alloc, Compare>(comp, alloc)
+{
+
+}
+
+/**
+* Inserts a key/value pair, or overwrites the value if the key is already present. The new node is red
+* and any red-red violation it causes is repaired on the way up. Returns an iterator to the item.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename RedBlackTree<Key, Value, NodeType, Alloc, Compare>::iterator RedBlackTree<Key, Value, NodeType, Alloc, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+	if(this->mRoot == nullptr)
+	{
+		this->mRoot = this->createNode(keyValuePair.first, keyValuePair.second, nullptr);
+		this->mRoot->setRed(false);
+		return typename RedBlackTree<Key, Value, NodeType, Alloc, Compare>::iterator(this->mRoot, this);
+	}
+	NodeType* curr = this->mRoot;
+	int c;
+	while((c = this->compareKeys(keyValuePair.first, curr->getKey())) != 0)
+	{
+		NodeType* next = c < 0 ? curr->getLeft() : curr->getRight();
+		if(next == nullptr)
+		{
+			NodeType* new_node = this->createNode(keyValuePair.first, keyValuePair.second, curr);
+			if(c < 0) curr->setLeft(new_node);
+			else curr->setRight(new_node);
+			insertFixup(new_node);
+			return typename RedBlackTree<Key, Value, NodeType, Alloc, Compare>::iterator(new_node, this);
+		}
+		curr = next;
+	}
+	//key already in the tree, overwrite the value
+	curr->setValue(keyValuePair.second);
+	return typename RedBlackTree<Key, Value, NodeType, Alloc, Compare>::iterator(curr, this);
+}
+
+/**
+* Removes a key if it is present.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void RedBlackTree<Key, Value, NodeType, Alloc, Compare>::remove(const Key& key)
+{
+	NodeType* node = this->internalFind(key);
+	if(node != nullptr) eraseNode(node);
+}
+
+//removes the leaf reached by going left where possible
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void RedBlackTree<Key, Value, NodeType, Alloc, Compare>::deleteMinLeaf()
+{
+	NodeType* leaf = this->getMinLeaf();
+	if(leaf != nullptr) eraseNode(leaf);
+}
+
+//missing children count as black
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+bool RedBlackTree<Key, Value, NodeType, Alloc, Compare>::isRed(const NodeType* node)
+{
+	return node != nullptr && node->isRed();
+}
+
+/**
+* Restores the red-black properties after node was inserted red. A red uncle is handled by recoloring
+* and moving the problem up two levels; a black uncle by one or two rotations, which ends the repair.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void RedBlackTree<Key, Value, NodeType, Alloc, Compare>::insertFixup(NodeType* node)
+{
+	while(isRed(node->getParent()))
+	{
+		NodeType* parent = node->getParent();
+		//a red parent is never the root, so the grandparent exists
+		NodeType* grand = parent->getParent();
+		if(parent == grand->getLeft())
+		{
+			NodeType* uncle = grand->getRight();
+			if(isRed(uncle))
+			{
+				parent->setRed(false);
+				uncle->setRed(false);
+				grand->setRed(true);
+				node = grand;
+				continue;
+			}
+			if(node == parent->getRight())
+			{
+				this->leftRotate(node);
+				node = parent;
+				parent = node->getParent();
+			}
+			parent->setRed(false);
+			grand->setRed(true);
+			this->rightRotate(parent);
+		}
+		else
+		{
+			NodeType* uncle = grand->getLeft();
+			if(isRed(uncle))
+			{
+				parent->setRed(false);
+				uncle->setRed(false);
+				grand->setRed(true);
+				node = grand;
+				continue;
+			}
+			if(node == parent->getLeft())
+			{
+				this->rightRotate(node);
+				node = parent;
+				parent = node->getParent();
+			}
+			parent->setRed(false);
+			grand->setRed(true);
+			this->leftRotate(parent);
+		}
+	}
+	this->mRoot->setRed(false);
+}
+
+/**
+* Unlinks and destroys node. A node with two children first trades places (and colors) with its
+* predecessor, so the node actually spliced out has at most one child. Removing a black node leaves its
+* paths one black short, which removeFixup repairs.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void RedBlackTree<Key, Value, NodeType, Alloc, Compare>::eraseNode(NodeType* node)
+{
+	if(node->getLeft() != nullptr && node->getRight() != nullptr)
+	{
+		NodeType* pred = node->getLeft();
+		while(pred->getRight() != nullptr) pred = pred->getRight();
+		this->swapWithPredecessor(node);
+		//colors belong to positions, not to items
+		bool red = node->isRed();
+		node->setRed(pred->isRed());
+		pred->setRed(red);
+	}
+	NodeType* child = node->getLeft() != nullptr ? node->getLeft() : node->getRight();
+	bool black = !node->isRed();
+	NodeType* parent = this->spliceOut(node);
+	if(black) removeFixup(child, parent);
+}
+
+/**
+* Repairs the black height after a black node was removed above node, which may be nullptr; parent is
+* passed separately for that case. node's side of parent is one black short until the deficit is pushed
+* up to the root or absorbed by a red node or a rotation at the sibling.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void RedBlackTree<Key, Value, NodeType, Alloc, Compare>::removeFixup(NodeType* node, NodeType* parent)
+{
+	while(node != this->mRoot && !isRed(node))
+	{
+		//the short side always has a sibling, so an empty left slot means node is on the left
+		if(node == parent->getLeft())
+		{
+			NodeType* sibling = parent->getRight();
+			if(isRed(sibling))
+			{
+				sibling->setRed(false);
+				parent->setRed(true);
+				this->leftRotate(sibling);
+				sibling = parent->getRight();
+			}
+			if(!isRed(sibling->getLeft()) && !isRed(sibling->getRight()))
+			{
+				sibling->setRed(true);
+				node = parent;
+				parent = node->getParent();
+				continue;
+			}
+			if(!isRed(sibling->getRight()))
+			{
+				sibling->getLeft()->setRed(false);
+				sibling->setRed(true);
+				this->rightRotate(sibling->getLeft());
+				sibling = parent->getRight();
+			}
+			sibling->setRed(parent->isRed());
+			parent->setRed(false);
+			sibling->getRight()->setRed(false);
+			this->leftRotate(sibling);
+			node = this->mRoot;
+		}
+		else
+		{
+			NodeType* sibling = parent->getLeft();
+			if(isRed(sibling))
+			{
+				sibling->setRed(false);
+				parent->setRed(true);
+				this->rightRotate(sibling);
+				sibling = parent->getLeft();
+			}
+			if(!isRed(sibling->getLeft()) && !isRed(sibling->getRight()))
+			{
+				sibling->setRed(true);
+				node = parent;
+				parent = node->getParent();
+				continue;
+			}
+			if(!isRed(sibling->getLeft()))
+			{
+				sibling->getRight()->setRed(false);
+				sibling->setRed(true);
+				this->leftRotate(sibling->getRight());
+				sibling = parent->getLeft();
+			}
+			sibling->setRed(parent->isRed());
+			parent->setRed(false);
+			sibling->getLeft()->setRed(false);
+			this->rightRotate(sibling);
+			node = this->mRoot;
+		}
+	}
+	if(node != nullptr) node->setRed(false);
+}
+
+#endif
@@ -1,32 +1,158 @@
 #ifndef ROTATE_BST_H
 #define ROTATE_BST_H
 
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
 #include "bst.h"
 
-template <typename Key, typename Value>
-class rotateBST : public BinarySearchTree<Key, Value>
+template <typename Key, typename Value, typename NodeType = Node<Key, Value>, 
+	typename Alloc = std::allocator<std::pair<const Key, Value> >, typename Compare = std::less<Key> >
+class rotateBST : public BinarySearchTree<Key, Value, NodeType, Alloc, Compare>
 {
 public:
+	explicit rotateBST(const Alloc& alloc = Alloc());
+	explicit rotateBST(const Compare& comp, const Alloc& alloc = Alloc());
 	void transform(rotateBST& t2) const;
+	void rebalance();
 protected:
-	void leftRotate(Node<Key, Value>* r);
-	void rightRotate(Node<Key, Value>* r);
+	void leftRotate(NodeType* r);
+	void rightRotate(NodeType* r);
+	void swapWithPredecessor(NodeType* node);
+	NodeType* spliceOut(NodeType* node);
+	NodeType* getMinLeaf() const;
+	NodeType* getMaxLeaf() const;
+	std::size_t makeVine();
+	void compressVine(std::size_t count);
+	void recomputeAll();
 };
 
-template <typename Key, typename Value>
-void rotateBST<Key, Value>::transform(rotateBST<Key, Value>& t2) const
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+rotateBST<Key, Value, NodeType, Alloc, Compare>::rotateBST(const Alloc& alloc)
+	: BinarySearchTree<Key, Value, NodeType, Alloc, Compare>(alloc)
 {
 
 }
 
-template <typename Key, typename Value>
-void rotateBST<Key, Value>::leftRotate(Node<Key, Value>* r)
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+rotateBST<Key, Value, NodeType, Alloc, Compare>::rotateBST(const Compare& comp, const Alloc& alloc)
+	: BinarySearchTree<Key, Value, NodeType, Alloc, Compare>(comp, alloc)
+{
+
+}
+
+/**
+* Gives t2 the shape of this tree using rotations only: the i-th smallest node of t2 ends up where the
+* i-th smallest node of this tree is. Both trees must hold the same number of keys, otherwise
+* std::invalid_argument is thrown.
+*
+* t2 is first rotated into a right vine. The rotations that would turn this tree into a right vine are
+* then worked out on a copy of its shape and applied to t2 undone, in reverse order. Each vine takes
+* fewer than n rotations, so at most 2n rotations are done in total.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void rotateBST<Key, Value, NodeType, Alloc, Compare>::transform(rotateBST<Key, Value, NodeType, Alloc, Compare>& t2) const
+{
+	if(&t2 == this) return;
+	const std::size_t NIL = static_cast<std::size_t>(-1);
+	//copy this tree's shape, with nodes numbered by their position in key order
+	std::vector<const NodeType*> nodes;
+	for(const NodeType* n = this->getSmallestNode(); n != nullptr; )
+	{
+		nodes.push_back(n);
+		//in-order successor through the parent links
+		if(n->getRight() != nullptr)
+		{
+			n = n->getRight();
+			while(n->getLeft() != nullptr) n = n->getLeft();
+		}
+		else
+		{
+			while(n->getParent() != nullptr && n->getParent()->getRight() == n) n = n->getParent();
+			n = n->getParent();
+		}
+	}
+	std::size_t n = nodes.size();
+	if(t2.makeVine() != n)
+	{
+		throw std::invalid_argument("transform: both trees must hold the same number of keys");
+	}
+	if(n == 0) return;
+	std::unordered_map<const NodeType*, std::size_t> position;
+	for(std::size_t i = 0; i < n; i++) position[nodes[i]] = i;
+	std::vector<std::size_t> left(n, NIL);
+	std::vector<std::size_t> right(n, NIL);
+	for(std::size_t i = 0; i < n; i++)
+	{
+		if(nodes[i]->getLeft() != nullptr) left[i] = position[nodes[i]->getLeft()];
+		if(nodes[i]->getRight() != nullptr) right[i] = position[nodes[i]->getRight()];
+	}
+	std::size_t root = position[this->mRoot];
+
+	//turn the copied shape into a right vine, remembering the node each right rotation pushed down
+	std::vector<std::size_t> pushedDown;
+	std::size_t parent = NIL;
+	std::size_t x = root;
+	while(x != NIL)
+	{
+		if(left[x] != NIL)
+		{
+			std::size_t y = left[x];
+			left[x] = right[y];
+			right[y] = x;
+			if(parent == NIL) root = y;
+			else right[parent] = y;
+			pushedDown.push_back(x);
+			x = y;
+		}
+		else
+		{
+			parent = x;
+			x = right[x];
+		}
+	}
+
+	//t2 is now that same vine, so undoing the rotations backwards gives it this tree's shape
+	std::vector<NodeType*> vine;
+	for(NodeType* v = t2.mRoot; v != nullptr; v = v->getRight()) vine.push_back(v);
+	for(std::size_t i = pushedDown.size(); i-- > 0; )
+	{
+		t2.leftRotate(vine[pushedDown[i]]);
+	}
+	t2.recomputeAll();
+}
+
+/**
+* Rebuilds the tree into a balanced shape in place, in O(n) time with no extra memory (Day, Stout and
+* Warren). The tree is rotated into a right vine and the vine is then folded in half repeatedly with
+* left rotations, which leaves every level full except possibly the last. Worth running during quiet
+* periods after access patterns (such as sequential lookups in a splay tree) have left a long path.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void rotateBST<Key, Value, NodeType, Alloc, Compare>::rebalance()
+{
+	std::size_t n = makeVine();
+	//size of the largest full tree that fits, the rest are leaves on the bottom level
+	std::size_t full = 1;
+	while(full <= n) full = 2 * full + 1;
+	full /= 2;
+	compressVine(n - full);
+	while(full > 1)
+	{
+		full /= 2;
+		compressVine(full);
+	}
+	recomputeAll();
+}
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void rotateBST<Key, Value, NodeType, Alloc, Compare>::leftRotate(NodeType* r)
 {
 	//nullptr return
 	if(r == nullptr) return;
 	if(r->getParent() == nullptr) return;
-	Node<Key, Value>* parent = r->getParent();
-	Node<Key, Value>* grand = parent->getParent();
+	NodeType* parent = r->getParent();
+	NodeType* grand = parent->getParent();
 	//first case- grandparent is nullptr
 	if(grand == nullptr) {
 		parent->setParent(r);
@@ -50,17 +176,20 @@ void rotateBST<Key, Value>::leftRotate(Node<Key, Value>* r)
 			parent->setParent(r);
 		}
 	}
+	//parent now hangs below r, so it is brought up to date first
+	parent->recompute();
+	r->recompute();
 }
 
-template <typename Key, typename Value>
-void rotateBST<Key, Value>::rightRotate(Node<Key, Value>* r)
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void rotateBST<Key, Value, NodeType, Alloc, Compare>::rightRotate(NodeType* r)
 {
 	//return if nullptr
 	if(r == nullptr) return;
 	if(r->getParent() == nullptr) return;
 	//declare parent and grandparent 
-	Node<Key, Value>* parent = r->getParent();
-	Node<Key, Value>* grand = parent->getParent();
+	NodeType* parent = r->getParent();
+	NodeType* grand = parent->getParent();
 	if(grand == nullptr) {
 		parent->setParent(r);
 		parent->setLeft(r->getRight());
@@ -83,6 +212,160 @@ void rotateBST<Key, Value>::rightRotate(Node<Key, Value>* r)
 			parent->setParent(r);
 		}
 	}
+	//parent now hangs below r, so it is brought up to date first
+	parent->recompute();
+	r->recompute();
+}
+
+/**
+* Exchanges the positions of a node with two children and its in-order predecessor by relinking, so
+* iterators and pointers to both stay valid. Afterwards node has no right child and can be spliced out.
+* Anything the nodes cache about their position (heights, colors) is left for the caller to fix.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void rotateBST<Key, Value, NodeType, Alloc, Compare>::swapWithPredecessor(NodeType* node)
+{
+	NodeType* pred = node->getLeft();
+	while(pred->getRight() != nullptr) pred = pred->getRight();
+	NodeType* parent = node->getParent();
+	NodeType* left = node->getLeft();
+	NodeType* right = node->getRight();
+	NodeType* predParent = pred->getParent();
+	NodeType* predLeft = pred->getLeft();
+
+	//pred moves up into node's place
+	if(parent == nullptr) this->mRoot = pred;
+	else if(parent->getLeft() == node) parent->setLeft(pred);
+	else parent->setRight(pred);
+	pred->setParent(parent);
+	pred->setRight(right);
+	right->setParent(pred);
+	if(pred == left)
+	{
+		pred->setLeft(node);
+		node->setParent(pred);
+	}
+	else
+	{
+		pred->setLeft(left);
+		left->setParent(pred);
+		predParent->setRight(node);
+		node->setParent(predParent);
+	}
+	//node moves down into pred's place
+	node->setLeft(predLeft);
+	if(predLeft != nullptr) predLeft->setParent(node);
+	node->setRight(nullptr);
+}
+
+/**
+* Replaces a node that has at most one child by that child and destroys it. Returns the node's parent,
+* where rebalancing has to start.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* rotateBST<Key, Value, NodeType, Alloc, Compare>::spliceOut(NodeType* node)
+{
+	NodeType* child = node->getLeft() != nullptr ? node->getLeft() : node->getRight();
+	NodeType* parent = node->getParent();
+	if(child != nullptr) child->setParent(parent);
+	if(parent == nullptr) this->mRoot = child;
+	else if(parent->getLeft() == node) parent->setLeft(child);
+	else parent->setRight(child);
+	this->destroyNode(node);
+	return parent;
+}
+
+//the leaf reached by going left where possible and right otherwise, nullptr for an empty tree
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* rotateBST<Key, Value, NodeType, Alloc, Compare>::getMinLeaf() const
+{
+	NodeType* curr = this->mRoot;
+	if(curr == nullptr) return nullptr;
+	while(curr->getLeft() != nullptr || curr->getRight() != nullptr)
+	{
+		curr = curr->getLeft() != nullptr ? curr->getLeft() : curr->getRight();
+	}
+	return curr;
+}
+
+//the leaf reached by going right where possible and left otherwise, nullptr for an empty tree
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* rotateBST<Key, Value, NodeType, Alloc, Compare>::getMaxLeaf() const
+{
+	NodeType* curr = this->mRoot;
+	if(curr == nullptr) return nullptr;
+	while(curr->getLeft() != nullptr || curr->getRight() != nullptr)
+	{
+		curr = curr->getRight() != nullptr ? curr->getRight() : curr->getLeft();
+	}
+	return curr;
+}
+
+/**
+* Turns the tree into a right vine (every node is the right child of its predecessor) with right
+* rotations and returns the number of nodes.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+std::size_t rotateBST<Key, Value, NodeType, Alloc, Compare>::makeVine()
+{
+	std::size_t count = 0;
+	NodeType* curr = this->mRoot;
+	while(curr != nullptr)
+	{
+		if(curr->getLeft() != nullptr)
+		{
+			NodeType* child = curr->getLeft();
+			rightRotate(child);
+			curr = child;
+		}
+		else
+		{
+			count++;
+			curr = curr->getRight();
+		}
+	}
+	return count;
+}
+
+//left rotates every other node down the right spine, count times
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void rotateBST<Key, Value, NodeType, Alloc, Compare>::compressVine(std::size_t count)
+{
+	NodeType* curr = this->mRoot;
+	for(std::size_t i = 0; i < count; i++)
+	{
+		NodeType* child = curr->getRight();
+		leftRotate(child);
+		curr = child->getRight();
+	}
+}
+
+/**
+* Recomputes the cached data of every node, children before parents. Rotations keep the data of the two
+* nodes they move correct, but when nodes cache something that depends on shape (such as Node's height)
+* the ancestors need it too after a sequence of them. The walk follows parent links, so it needs no stack.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void rotateBST<Key, Value, NodeType, Alloc, Compare>::recomputeAll()
+{
+	if(!NodeType::AUGMENTED || this->mRoot == nullptr) return;
+	//the first node in post-order is the leaf reached going left where possible
+	NodeType* curr = getMinLeaf();
+	while(curr != nullptr)
+	{
+		curr->recompute();
+		NodeType* parent = curr->getParent();
+		if(parent != nullptr && parent->getLeft() == curr && parent->getRight() != nullptr)
+		{
+			//the parent's right subtree comes next, starting at its first node in post-order
+			curr = parent->getRight();
+			while(curr->getLeft() != nullptr || curr->getRight() != nullptr)
+			{
+				curr = curr->getLeft() != nullptr ? curr->getLeft() : curr->getRight();
+			}
+		}
+		else curr = parent;
+	}
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+#include "splayTree.h"
+
+/**
+* Checks unionWith, intersectWith and differenceWith against std::map with either tree the smaller one,
+* and checks that merging a handful of keys into a large tree does not walk the large tree.
+*/
+
+//a splay node that counts how often trees redo its cached data, which every restructuring does
+static std::atomic<std::size_t> recomputes(0);
+
+template <typename Key, typename Value>
+class CountingNode : public NodeBase<Key, Value, CountingNode<Key, Value> >
+{
+public:
+	static const bool AUGMENTED = true;
+
+	CountingNode(const Key& key, const Value& value, CountingNode<Key, Value>* parent)
+		: NodeBase<Key, Value, CountingNode<Key, Value> >(key, value, parent)
+	{
+
+	}
+
+	void recompute()
+	{
+		recomputes++;
+	}
+};
+
+typedef SplayTree<int, int> Tree;
+
+std::map<int, int> contents(Tree& tree)
+{
+	std::map<int, int> items;
+	for(Tree::iterator it = tree.begin(); it != tree.end(); ++it) items[it->first] = it->second;
+	return items;
+}
+
+//fills a tree and its reference with n random keys below range, all with the given value
+void fill(Tree& tree, std::map<int, int>& reference, int n, int range, int value, std::mt19937& rng)
+{
+	for(int i = 0; i < n; i++)
+	{
+		int key = static_cast<int>(rng() % range);
+		tree.insert(std::make_pair(key, value));
+		reference[key] = value;
+	}
+}
+
+void checkAgainstMap(int na, int nb, std::size_t threads, std::mt19937& rng)
+{
+	for(int op = 0; op < 3; op++)
+	{
+		Tree a;
+		Tree b;
+		std::map<int, int> ma;
+		std::map<int, int> mb;
+		fill(a, ma, na, 4 * (na + nb) + 1, 1, rng);
+		fill(b, mb, nb, 4 * (na + nb) + 1, 2, rng);
+		std::map<int, int> expected;
+		if(op == 0)
+		{
+			expected = ma;
+			for(std::map<int, int>::iterator it = mb.begin(); it != mb.end(); ++it) expected[it->first] = it->second;
+			a.unionWith(b, threads);
+			assert(b.begin() == b.end());
+		}
+		else
+		{
+			for(std::map<int, int>::iterator it = ma.begin(); it != ma.end(); ++it)
+			{
+				if((mb.count(it->first) > 0) == (op == 1)) expected.insert(*it);
+			}
+			if(op == 1) a.intersectWith(b, threads);
+			else a.differenceWith(b, threads);
+			assert(contents(b) == mb);
+			for(std::map<int, int>::iterator it = mb.begin(); it != mb.end(); ++it) assert(b.find(it->first) != b.end());
+		}
+		assert(contents(a) == expected);
+		for(std::map<int, int>::iterator it = expected.begin(); it != expected.end(); ++it)
+		{
+			assert(a.find(it->first) != a.end() && a.find(it->first)->second == it->second);
+		}
+	}
+}
+
+int main()
+{
+	std::mt19937 rng(7);
+	std::size_t threads[] = { 1, 4 };
+	for(int t = 0; t < 2; t++)
+	{
+		checkAgainstMap(3000, 3000, threads[t], rng);
+		checkAgainstMap(20, 5000, threads[t], rng);
+		checkAgainstMap(5000, 20, threads[t], rng);
+		checkAgainstMap(0, 100, threads[t], rng);
+		checkAgainstMap(100, 0, threads[t], rng);
+	}
+
+	//10 keys into 1M, either way round: the large tree is only split by splays, never rebalanced
+	const int n = 1000000;
+	std::vector<int> keys;
+	for(int i = 0; i < n; i++) keys.push_back(2 * i);
+	std::shuffle(keys.begin(), keys.end(), rng);
+	for(int way = 0; way < 2; way++)
+	{
+		SplayTree<int, int, CountingNode<int, int> > large;
+		SplayTree<int, int, CountingNode<int, int> > small;
+		for(int i = 0; i < n; i++) large.insert(std::make_pair(keys[i], 0));
+		for(int i = 0; i < 10; i++) small.insert(std::make_pair(static_cast<int>(rng() % (2 * n)), 1));
+		recomputes = 0;
+		if(way == 0)
+		{
+			large.unionWith(small, 4);
+			assert(small.begin() == small.end());
+		}
+		else
+		{
+			small.unionWith(large, 4);
+			assert(large.begin() == large.end());
+		}
+		std::printf("10 keys into %d, way %d: %zu nodes recomputed\n", n, way, recomputes.load());
+		assert(recomputes < n / 100);
+	}
+
+	std::printf("set operations: ok\n");
+	return 0;
+}
@@ -0,0 +1,278 @@
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/**
+* A pool of fixed-size blocks carved out of large chunks. Freed blocks go on an intrusive free list and
+* are handed out again before any new chunk memory is touched. The block size is fixed by the first
+* allocation, which suits search trees since they only ever allocate one node type.
+*/
+class SlabPool
+{
+public:
+	SlabPool(bool hugePages);
+	~SlabPool();
+
+	void* allocate(std::size_t bytes);
+	void deallocate(void* block, std::size_t bytes);
+	void release();
+	bool owns(std::size_t bytes) const;
+
+private:
+	SlabPool(const SlabPool& other);
+	SlabPool& operator=(const SlabPool& other);
+	void grow();
+	void freeChunk(void* chunk);
+
+	//a free block stores the next free block in its own memory
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	static const std::size_t CHUNK_BYTES = std::size_t(2) << 20;
+
+	std::size_t mBlockSize;
+	std::size_t mRequestSize;
+	bool mHugePages;
+	FreeBlock* mFreeList;
+	char* mBump;
+	char* mBumpEnd;
+	std::vector<void*> mChunks;
+};
+
+/**
+* A standard allocator backed by a shared SlabPool. Copies and rebound copies share the pool, so a tree
+* that rebinds the allocator to its node type still draws from the pool the caller handed in.
+* Single-object requests of the pool's block size come from the pool; anything else goes to operator new.
+*
+* Set hugePages to back chunks with transparent huge pages where the platform supports it.
+*/
+template <typename T>
+class SlabAllocator
+{
+public:
+	typedef T value_type;
+
+	explicit SlabAllocator(bool hugePages = false);
+	template <typename U>
+	SlabAllocator(const SlabAllocator<U>& other);
+
+	T* allocate(std::size_t n);
+	void deallocate(T* p, std::size_t n);
+	bool release();
+
+	template <typename U>
+	bool operator==(const SlabAllocator<U>& rhs) const;
+	template <typename U>
+	bool operator!=(const SlabAllocator<U>& rhs) const;
+
+	std::shared_ptr<SlabPool> mPool;
+};
+
+/**
+* Releases every node of a tree at once when its allocator allows it. The general case cannot, and the
+* tree has to walk and destroy its nodes one by one.
+*/
+template <typename Alloc>
+struct AllocatorRelease
+{
+	static bool release(Alloc&)
+	{
+		return false;
+	}
+};
+
+template <typename T>
+struct AllocatorRelease<SlabAllocator<T> >
+{
+	static bool release(SlabAllocator<T>& alloc)
+	{
+		return alloc.release();
+	}
+};
+
+/*
+	--------------------------------------------
+	Begin implementations for the SlabPool class.
+	--------------------------------------------
+*/
+
+inline SlabPool::SlabPool(bool hugePages)
+	: mBlockSize(0)
+	, mRequestSize(0)
+	, mHugePages(hugePages)
+	, mFreeList(nullptr)
+	, mBump(nullptr)
+	, mBumpEnd(nullptr)
+{
+
+}
+
+inline SlabPool::~SlabPool()
+{
+	release();
+}
+
+/**
+* Returns true if requests of this many bytes are served by the pool. The first request fixes the size.
+*/
+inline bool SlabPool::owns(std::size_t bytes) const
+{
+	return mRequestSize == 0 || mRequestSize == bytes;
+}
+
+inline void* SlabPool::allocate(std::size_t bytes)
+{
+	if(mRequestSize == 0)
+	{
+		//round blocks up so every block is suitably aligned and can hold a free list link
+		const std::size_t align = alignof(std::max_align_t);
+		mRequestSize = bytes;
+		mBlockSize = (std::max(bytes, sizeof(FreeBlock)) + align - 1) / align * align;
+	}
+	//reuse a freed block first
+	if(mFreeList != nullptr)
+	{
+		FreeBlock* block = mFreeList;
+		mFreeList = block->next;
+		return block;
+	}
+	if(mBump == nullptr || mBump + mBlockSize > mBumpEnd) grow();
+	void* block = mBump;
+	mBump += mBlockSize;
+	return block;
+}
+
+inline void SlabPool::deallocate(void* block, std::size_t)
+{
+	FreeBlock* freed = static_cast<FreeBlock*>(block);
+	freed->next = mFreeList;
+	mFreeList = freed;
+}
+
+/**
+* Frees every chunk in O(chunks), without visiting the blocks in them. Any object still living in the
+* pool is gone afterwards, so callers must only do this when they own everything in it.
+*/
+inline void SlabPool::release()
+{
+	for(std::size_t i = 0; i < mChunks.size(); i++) freeChunk(mChunks[i]);
+	mChunks.clear();
+	mFreeList = nullptr;
+	mBump = nullptr;
+	mBumpEnd = nullptr;
+}
+
+inline void SlabPool::grow()
+{
+	void* chunk = nullptr;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	if(mHugePages)
+	{
+		chunk = mmap(nullptr, CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(chunk == MAP_FAILED) throw std::bad_alloc();
+		//only a hint, the kernel may still use small pages
+		madvise(chunk, CHUNK_BYTES, MADV_HUGEPAGE);
+	}
+#endif
+	if(chunk == nullptr) chunk = ::operator new(CHUNK_BYTES);
+	mChunks.push_back(chunk);
+	mBump = static_cast<char*>(chunk);
+	mBumpEnd = mBump + CHUNK_BYTES;
+}
+
+inline void SlabPool::freeChunk(void* chunk)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+	if(mHugePages)
+	{
+		munmap(chunk, CHUNK_BYTES);
+		return;
+	}
+#endif
+	::operator delete(chunk);
+}
+
+/*
+	------------------------------------------
+	End implementations for the SlabPool class.
+	------------------------------------------
+*/
+
+/*
+	-------------------------------------------------
+	Begin implementations for the SlabAllocator class.
+	-------------------------------------------------
+*/
+
+template <typename T>
+SlabAllocator<T>::SlabAllocator(bool hugePages)
+	: mPool(std::make_shared<SlabPool>(hugePages))
+{
+
+}
+
+template <typename T>
+template <typename U>
+SlabAllocator<T>::SlabAllocator(const SlabAllocator<U>& other)
+	: mPool(other.mPool)
+{
+
+}
+
+template <typename T>
+T* SlabAllocator<T>::allocate(std::size_t n)
+{
+	if(n == 1 && mPool->owns(sizeof(T))) return static_cast<T*>(mPool->allocate(sizeof(T)));
+	return static_cast<T*>(::operator new(n * sizeof(T)));
+}
+
+template <typename T>
+void SlabAllocator<T>::deallocate(T* p, std::size_t n)
+{
+	if(n == 1 && mPool->owns(sizeof(T))) mPool->deallocate(p, sizeof(T));
+	else ::operator delete(p);
+}
+
+/**
+* Drops every chunk of the pool if this allocator is its only user, and reports whether it did.
+*/
+template <typename T>
+bool SlabAllocator<T>::release()
+{
+	if(mPool.use_count() != 1) return false;
+	mPool->release();
+	return true;
+}
+
+template <typename T>
+template <typename U>
+bool SlabAllocator<T>::operator==(const SlabAllocator<U>& rhs) const
+{
+	return mPool == rhs.mPool;
+}
+
+template <typename T>
+template <typename U>
+bool SlabAllocator<T>::operator!=(const SlabAllocator<U>& rhs) const
+{
+	return mPool != rhs.mPool;
+}
+
+/*
+	-----------------------------------------------
+	End implementations for the SlabAllocator class.
+	-----------------------------------------------
+*/
+
+#endif
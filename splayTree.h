@@ -1,211 +1,1429 @@
 #ifndef SPLAY_TREE_H
 #define SPLAY_TREE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
 #include "rotateBST.h"
+#include "frozenIndex.h"
 
+/**
+* The node layout used by SplayTree: just the item and the three links. Splaying never looks at
+* heights, so unlike Node there is no height field.
+*/
 template <typename Key, typename Value>
-class SplayTree : public rotateBST<Key, Value>
+class SplayNode : public NodeBase<Key, Value, SplayNode<Key, Value> >
 {
 public:
-	SplayTree();
-	void insert(const std::pair<const Key, Value>& keyValuePair);
-	void remove(const Key& key);
-	typename SplayTree<Key, Value>::iterator find(const Key& key);
-	typename SplayTree<Key, Value>::iterator findMin();
-	typename SplayTree<Key, Value>::iterator findMax();
-	void deleteMinLeaf();
-	void deleteMaxLeaf();
+	SplayNode(const Key& key, const Value& value, SplayNode<Key, Value>* parent);
+};
+
+template <typename Key, typename Value>
+SplayNode<Key, Value>::SplayNode(const Key& key, const Value& value, SplayNode<Key, Value>* parent)
+	: NodeBase<Key, Value, SplayNode<Key, Value> >(key, value, parent)
+{
+
+}
+
+/**
+* A splay node that also counts the nodes in its subtree, which is what SplayTree's order-statistic
+* queries (select, rank, countRange) read. Trees built on SplayNode leave the count out and pay nothing
+* for it.
+*/
+template <typename Key, typename Value>
+class SizedSplayNode : public NodeBase<Key, Value, SizedSplayNode<Key, Value> >
+{
+public:
+	static const bool AUGMENTED = true;
+
+	SizedSplayNode(const Key& key, const Value& value, SizedSplayNode<Key, Value>* parent);
+
+	std::size_t getSize() const;
+	void recompute();
+
 protected:
-	void splay(Node<Key, Value> *r);
+	std::size_t mSize;
 };
 
 template <typename Key, typename Value>
-SplayTree<Key, Value>::SplayTree()
+SizedSplayNode<Key, Value>::SizedSplayNode(const Key& key, const Value& value, SizedSplayNode<Key, Value>* parent)
+	: NodeBase<Key, Value, SizedSplayNode<Key, Value> >(key, value, parent)
+	, mSize(1)
 {
 
 }
 
 template <typename Key, typename Value>
-void SplayTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+std::size_t SizedSplayNode<Key, Value>::getSize() const
 {
-	//insert node into the tree using bst insert
-	BinarySearchTree<Key, Value>::insert(keyValuePair);
-	//node of corresponding key 
-	Node<Key, Value>* curr = BinarySearchTree<Key, Value>::internalFind(keyValuePair.first);
-	//if curr is not null splay
-	if(curr != nullptr) splay(curr);
+	return mSize;
 }
 
+//the size of a subtree is one for the node itself plus the sizes of both children
 template <typename Key, typename Value>
-void SplayTree<Key, Value>::remove(const Key& key)
-{
-	//SplayTree<Key, Value>::iterator it = find(key);
-	Node<Key, Value>* curr = BinarySearchTree<Key, Value>::internalFind(key);
-	splay(curr);
-	Node<Key, Value>* pred = curr->getLeft();
-	Node<Key, Value>* right = curr->getRight();
-	if(pred != nullptr)
-	{
-		if(pred->getRight() != nullptr) {
-			while(pred->getRight() != nullptr) {
-				pred = pred->getRight();
-			}
-		}
+void SizedSplayNode<Key, Value>::recompute()
+{
+	mSize = 1;
+	if(this->mLeft != nullptr) mSize += this->mLeft->getSize();
+	if(this->mRight != nullptr) mSize += this->mRight->getSize();
+}
+
+/**
+* How SplayTree::find restructures the tree after a lookup. Inserts and removes always splay fully.
+*
+* FULL_SPLAY: the found node (or the last node on the search path) is splayed to the root.
+* SEMI_SPLAY: semi-splaying (Sleator and Tarjan), which does one rotation per zig-zig step instead of two
+*	and roughly halves the node's depth rather than lifting it to the root.
+* DEPTH_SPLAY: the node is splayed only when it was found deeper than the strategy parameter, so lookups
+*	near the top of the tree do not write to it at all.
+* RANDOM_SPLAY: the node is splayed on one lookup in parameter, picked at random.
+*/
+enum SplayStrategy
+{
+	FULL_SPLAY,
+	SEMI_SPLAY,
+	DEPTH_SPLAY,
+	RANDOM_SPLAY
+};
+
+template <typename Key, typename Value, typename NodeType = SplayNode<Key, Value>, 
+	typename Alloc = std::allocator<std::pair<const Key, Value> >, typename Compare = std::less<Key> >
+class SplayTree : public rotateBST<Key, Value, NodeType, Alloc, Compare>
+{
+public:
+	explicit SplayTree(const Alloc& alloc = Alloc());
+	explicit SplayTree(const Compare& comp, const Alloc& alloc = Alloc());
+	template <typename ForwardIt>
+	SplayTree(ForwardIt first, ForwardIt last, const Compare& comp = Compare(), const Alloc& alloc = Alloc());
+	SplayTree(const SplayTree<Key, Value, NodeType, Alloc, Compare>& other);
+	SplayTree<Key, Value, NodeType, Alloc, Compare>& operator=(const SplayTree<Key, Value, NodeType, Alloc, Compare>& other);
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator insert(const std::pair<const Key, Value>& keyValuePair);
+	void remove(const Key& key);
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator find(const Key& key);
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator find(const K& key);
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator findNear(const Key& key);
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator findNear(
+		typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator finger, const Key& key);
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator findMin();
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator findMax();
+	void deleteMinLeaf();
+	void deleteMaxLeaf();
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator peekMin();
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator peekMax();
+	void popMin();
+	void popMax();
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator decreaseKey(
+		typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator handle, const Key& key);
+	void split(const Key& key, SplayTree<Key, Value, NodeType, Alloc, Compare>& right);
+	void join(SplayTree<Key, Value, NodeType, Alloc, Compare>& right);
+	void eraseRange(const Key& lo, const Key& hi);
+	void unionWith(SplayTree<Key, Value, NodeType, Alloc, Compare>& other, std::size_t threads = 0);
+	void intersectWith(SplayTree<Key, Value, NodeType, Alloc, Compare>& other, std::size_t threads = 0);
+	void differenceWith(SplayTree<Key, Value, NodeType, Alloc, Compare>& other, std::size_t threads = 0);
+	template <typename ForwardIt>
+	std::size_t insertBatch(ForwardIt first, ForwardIt last);
+	template <typename InputIt, typename OutputIt>
+	OutputIt findBatch(InputIt first, InputIt last, OutputIt out);
+	template <typename ForwardIt, typename OutputIt>
+	OutputIt multiFind(ForwardIt first, ForwardIt last, OutputIt out, bool splayResults = false);
+	template <typename InputIt>
+	std::size_t eraseBatch(InputIt first, InputIt last);
+	std::size_t size() const;
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator select(std::size_t k);
+	std::size_t rank(const Key& key);
+	std::size_t countRange(const Key& lo, const Key& hi);
+	Value aggregate(const Key& lo, const Key& hi);
+	void setSplayStrategy(SplayStrategy strategy, std::size_t parameter = 0);
+	FrozenIndex<Key, Value, Compare> freeze();
+	void thaw(const FrozenIndex<Key, Value, Compare>& index);
+	void clear();
+protected:
+	static std::size_t subtreeSize(const NodeType* node);
+	void splay(NodeType *r);
+	void semiSplay(NodeType* r);
+	void rotateUp(NodeType* r);
+	void afterLookup(NodeType* node, std::size_t depth);
+	NodeType* locateFrom(NodeType* start, const Key& key, int* order, std::size_t* steps = nullptr);
+	NodeType* detachFrom(const Key& key);
+	void attachGreater(NodeType* right);
+	void checkCompatible(const SplayTree<Key, Value, NodeType, Alloc, Compare>& other) const;
+	static bool smallerTree(NodeType* a, NodeType* b);
+	void splitNodes(NodeType* root, const Key& key, NodeType** less, NodeType** equal, NodeType** greater);
+	static NodeType* joinNodes(NodeType* left, NodeType* middle, NodeType* right);
+	NodeType* joinNodes(NodeType* left, NodeType* right);
+	NodeType* unionNodes(NodeType* a, NodeType* b, bool bWins, std::vector<NodeType*>& garbage, std::size_t depth);
+	NodeType* filterNodes(NodeType* a, const NodeType* b, bool keepCommon, std::vector<NodeType*>& garbage, std::size_t depth);
+	NodeType* filterByNodes(NodeType* a, NodeType* b, bool keepCommon, std::vector<NodeType*>& garbage, std::size_t depth, NodeType** restored);
+	template <typename K>
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator findKey(const K& key);
+	template <typename Direction>
+	NodeType* splayTopDown(NodeType* t, Direction dir, int* order = nullptr);
+	template <typename K>
+	NodeType* splayKey(NodeType* t, const K& key, int* order = nullptr);
+	NodeType* splayMin(NodeType* t);
+	NodeType* splayMax(NodeType* t);
+	void linkRoot(NodeType* node, NodeType* root, int order);
+	NodeType* cachedMin();
+	NodeType* cachedMax();
+	void forgetNode(const NodeType* node);
+	void forgetExtremes();
+
+	NodeType* mFinger;
+	//the nodes holding the smallest and largest keys, nullptr when not known (see cachedMin)
+	NodeType* mMin;
+	NodeType* mMax;
+	SplayStrategy mStrategy;
+	std::size_t mStrategyParameter;
+	uint32_t mSeed;
+};
+
+/**
+* A SplayTree with subtree sizes, for select, rank and countRange. The rest of the interface is the same
+* as SplayTree's.
+*/
+template <typename Key, typename Value, typename Alloc = std::allocator<std::pair<const Key, Value> >,
+	typename Compare = std::less<Key> >
+using RankedSplayTree = SplayTree<Key, Value, SizedSplayNode<Key, Value>, Alloc, Compare>;
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+SplayTree<Key, Value, NodeType, Alloc, Compare>::SplayTree(const Alloc& alloc)
+	: rotateBST<Key, Value, NodeType, Alloc, Compare>(alloc)
+	, mFinger(nullptr)
+	, mMin(nullptr)
+	, mMax(nullptr)
+	, mStrategy(FULL_SPLAY)
+	, mStrategyParameter(0)
+	, mSeed(0x9E3779B9u)
+{
+
+}
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+SplayTree<Key, Value, NodeType, Alloc, Compare>::SplayTree(const Compare& comp, const Alloc& alloc)
+	: rotateBST<Key, Value, NodeType, Alloc, Compare>(comp, alloc)
+	, mFinger(nullptr)
+	, mMin(nullptr)
+	, mMax(nullptr)
+	, mStrategy(FULL_SPLAY)
+	, mStrategyParameter(0)
+	, mSeed(0x9E3779B9u)
+{
+
+}
+
+/**
+* Bulk-loading constructor, builds a balanced tree from the key/value pairs in [first, last) in O(n)
+* when they are sorted by key. See BinarySearchTree::assign.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template <typename ForwardIt>
+SplayTree<Key, Value, NodeType, Alloc, Compare>::SplayTree(ForwardIt first, ForwardIt last, const Compare& comp, const Alloc& alloc)
+	: rotateBST<Key, Value, NodeType, Alloc, Compare>(comp, alloc)
+	, mFinger(nullptr)
+	, mMin(nullptr)
+	, mMax(nullptr)
+	, mStrategy(FULL_SPLAY)
+	, mStrategyParameter(0)
+	, mSeed(0x9E3779B9u)
+{
+	this->assign(first, last);
+}
+
+/**
+* Copy constructor, O(n): the copy has other's shape and splay strategy (see BinarySearchTree's copy
+* constructor). Fingers and cached extremes point into other, so the copy starts without them.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+SplayTree<Key, Value, NodeType, Alloc, Compare>::SplayTree(const SplayTree<Key, Value, NodeType, Alloc, Compare>& other)
+	: rotateBST<Key, Value, NodeType, Alloc, Compare>(other)
+	, mFinger(nullptr)
+	, mMin(nullptr)
+	, mMax(nullptr)
+	, mStrategy(other.mStrategy)
+	, mStrategyParameter(other.mStrategyParameter)
+	, mSeed(other.mSeed)
+{
+
+}
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+SplayTree<Key, Value, NodeType, Alloc, Compare>& SplayTree<Key, Value, NodeType, Alloc, Compare>::operator=(const SplayTree<Key, Value, NodeType, Alloc, Compare>& other)
+{
+	if(&other == this) return *this;
+	rotateBST<Key, Value, NodeType, Alloc, Compare>::operator=(other);
+	mFinger = nullptr;
+	forgetExtremes();
+	mStrategy = other.mStrategy;
+	mStrategyParameter = other.mStrategyParameter;
+	return *this;
+}
+
+/**
+* Inserts a key/value pair. The tree is splayed top-down on the key in a single descent, so the
+* new node (or the existing node, whose value is overwritten) ends up at the root. Returns an iterator
+* to it.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+	if(this->mRoot == nullptr)
+	{
+		this->mRoot = this->createNode(keyValuePair.first, keyValuePair.second, nullptr);
+		mFinger = this->mRoot;
+		mMin = this->mRoot;
+		mMax = this->mRoot;
+		return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(this->mRoot, this);
 	}
-	if(curr != nullptr) BinarySearchTree<Key, Value>::remove(key);
-	else return;
-	if(pred != nullptr) {
-		splay(pred);
-		this->mRoot = pred;
-		pred->setRight(right);
+	int order;
+	NodeType* root = splayKey(this->mRoot, keyValuePair.first, &order);
+	//key already present, overwrite the value
+	if(order == 0)
+	{
+		root->setValue(keyValuePair.second);
+		this->mRoot = root;
+		mFinger = root;
+		return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(this->mRoot, this);
 	}
-	else if(right != nullptr) {
+	NodeType* new_node = this->createNode(keyValuePair.first, keyValuePair.second, nullptr);
+	linkRoot(new_node, root, order);
+	//a new extreme replaces a known one; an unknown one stays unknown
+	if(mMin != nullptr && this->compareKeys(keyValuePair.first, mMin->getKey()) < 0) mMin = new_node;
+	if(mMax != nullptr && this->compareKeys(keyValuePair.first, mMax->getKey()) > 0) mMax = new_node;
+	return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(new_node, this);
+}
+
+/**
+* Removes a key. The key is splayed to the root, the root is deleted and the two remaining subtrees
+* are joined by splaying the maximum of the left subtree to its top.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::remove(const Key& key)
+{
+	if(this->mRoot == nullptr) return;
+	int order;
+	NodeType* root = splayKey(this->mRoot, key, &order);
+	this->mRoot = root;
+	//key not in the tree
+	if(order != 0) return;
+
+	NodeType* left = root->getLeft();
+	NodeType* right = root->getRight();
+	mFinger = nullptr;
+	forgetNode(root);
+	this->destroyNode(root);
+	if(left == nullptr)
+	{
+		if(right != nullptr) right->setParent(nullptr);
 		this->mRoot = right;
+		return;
 	}
-	//if parent exists 
-	else this->mRoot = nullptr;
+	left->setParent(nullptr);
+	//the max of the left subtree has no right child once splayed
+	left = splayMax(left);
+	left->setRight(right);
+	if(right != nullptr) right->setParent(left);
+	left->recompute();
+	this->mRoot = left;
 }
 
-template <typename Key, typename Value>
-typename SplayTree<Key, Value>::iterator SplayTree<Key, Value>::find(const Key& key)
+/**
+* Returns an iterator to the item with the given key, or the end iterator if the key does not exist.
+* Either way the last node on the search path is splayed to the root.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::find(const Key& key)
+{
+	return findKey(key);
+}
+
+/**
+* Heterogeneous find, available when Compare is transparent (e.g. std::less<>), so that a key that
+* compares against Key can be looked up without building a temporary Key.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template <typename K, typename C, typename>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::find(const K& key)
+{
+	return findKey(key);
+}
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template <typename K>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::findKey(const K& key)
+{
+	if(this->mRoot == nullptr) return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(nullptr, this);
+	if(mStrategy == FULL_SPLAY)
+	{
+		int order;
+		this->mRoot = splayKey(this->mRoot, key, &order);
+		mFinger = this->mRoot;
+		if(order != 0) return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(nullptr, this);
+		return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(this->mRoot, this);
+	}
+	//the other strategies search without writing and decide afterwards whether to restructure
+	NodeProbe<NodeType, K, Compare> probe(key, this->mCompare);
+	NodeType* curr = this->mRoot;
+	NodeType* last = nullptr;
+	std::size_t depth = 0;
+	int c = 1;
+	while(curr != nullptr)
+	{
+		prefetchChildren(curr);
+		last = curr;
+		c = probe.compare(curr);
+		if(c == 0) break;
+		curr = c < 0 ? curr->getLeft() : curr->getRight();
+		if(curr != nullptr) depth++;
+	}
+	afterLookup(last, depth);
+	mFinger = last;
+	if(c != 0) return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(nullptr, this);
+	return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(last, this);
+}
+
+/**
+* Finger search from the node the last lookup or insert ended on. See findNear(finger, key).
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::findNear(const Key& key)
+{
+	return findNear(typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(mFinger, this), key);
+}
+
+/**
+* Finger search: looks key up starting from the node finger points at instead of the root. The search
+* climbs the parent links only until it reaches an ancestor whose subtree must hold key, then descends
+* (see locateFrom), so keys close to the finger are found without touching the upper part of the tree. The node reached
+* is then splayed according to the splay strategy, as find does, and becomes the new implicit finger.
+* An end iterator as finger searches from the root. Returns the end iterator if key is not present.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::findNear(
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator finger, const Key& key)
 {
-	Node<Key, Value>* curr = this->mRoot;
-	//not nullptr
-	while((curr->getRight() != nullptr || curr->getLeft() != nullptr) && key != curr->getItem().first)
+	if(this->mRoot == nullptr) return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(nullptr, this);
+	int c;
+	std::size_t steps;
+	NodeType* curr = locateFrom(this->nodeOf(finger), key, &c, &steps);
+	afterLookup(curr, steps);
+	mFinger = curr;
+	if(c != 0) return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(nullptr, this);
+	return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(curr, this);
+}
+
+/**
+* The search behind findNear and the batch operations: finds key, or the last node on its search path,
+* starting from start (the root if start is nullptr) without restructuring anything. The search climbs
+* the parent links only until it reaches an ancestor whose subtree must hold key, then descends. order
+* receives the comparison of key against the node returned and steps the number of links followed.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::locateFrom(NodeType* start, const Key& key, int* order, std::size_t* steps)
+{
+	NodeType* curr = start != nullptr ? start : this->mRoot;
+	NodeProbe<NodeType, Key, Compare> probe(key, this->mCompare);
+	std::size_t links = 0;
+	int c = probe.compare(curr);
+	//climb: curr's subtree is bounded on key's side by the first ancestor that curr lies on the other side of
+	while(c != 0)
 	{
-		//go left
-		if(key < curr->getItem().first)
+		NodeType* bound = curr;
+		if(c > 0)
 		{
-			if(curr->getLeft()) curr = curr->getLeft();
-			else break;
+			while(bound->getParent() != nullptr && bound->getParent()->getRight() == bound) bound = bound->getParent();
 		}
-		//go right
-		else if(key > curr->getItem().first)
+		else
 		{
-			if(curr->getRight()) curr = curr->getRight();
-			else break;
+			while(bound->getParent() != nullptr && bound->getParent()->getLeft() == bound) bound = bound->getParent();
 		}
+		bound = bound->getParent();
+		//no bound on that side, or key lies strictly between curr and the bound
+		if(bound == nullptr) break;
+		int cb = probe.compare(bound);
+		if((c > 0 && cb < 0) || (c < 0 && cb > 0)) break;
+		curr = bound;
+		c = cb;
+		links++;
 	}
-	//splay function
-	if(key != curr->getItem().first)
+	//descend
+	while(c != 0)
 	{
-		splay(curr);
-		return typename SplayTree<Key, Value>::iterator(nullptr);
+		NodeType* next = c < 0 ? curr->getLeft() : curr->getRight();
+		if(next == nullptr) break;
+		prefetchChildren(next);
+		curr = next;
+		c = probe.compare(curr);
+		links++;
 	}
-	else
+	*order = c;
+	if(steps != nullptr) *steps = links;
+	return curr;
+}
+
+/**
+* Chooses how find restructures the tree, see SplayStrategy. parameter is the depth threshold for
+* DEPTH_SPLAY and the k of one-in-k for RANDOM_SPLAY, and is ignored otherwise.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::setSplayStrategy(SplayStrategy strategy, std::size_t parameter)
+{
+	mStrategy = strategy;
+	mStrategyParameter = parameter;
+}
+
+/**
+* Moves the items into a FrozenIndex and returns it, leaving the tree empty. For a tree that will only be
+* read from now on: the index keeps no links, so it takes a fraction of the memory, its lookups never
+* write, and it can be queried from many threads at once. O(n).
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+FrozenIndex<Key, Value, Compare> SplayTree<Key, Value, NodeType, Alloc, Compare>::freeze()
+{
+	FrozenIndex<Key, Value, Compare> index(this->cbegin(), this->cend(), this->mCompare);
+	clear();
+	return index;
+}
+
+/**
+* Replaces the contents of the tree with the items of index, as a perfectly balanced tree. O(n).
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::thaw(const FrozenIndex<Key, Value, Compare>& index)
+{
+	std::vector<std::pair<Key, Value> > items;
+	items.reserve(index.size());
+	index.forEach([&items](const Key& key, const Value& value) {
+		items.push_back(std::make_pair(key, value));
+	});
+	this->assign(items.begin(), items.end());
+}
+
+//drops the finger and the cached extremes along with the nodes
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::clear()
+{
+	mFinger = nullptr;
+	forgetExtremes();
+	rotateBST<Key, Value, NodeType, Alloc, Compare>::clear();
+}
+
+//applies the splay strategy to the last node of a lookup, found at the given depth
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::afterLookup(NodeType* node, std::size_t depth)
+{
+	switch(mStrategy)
 	{
-		splay(curr);
-		return typename SplayTree<Key, Value>::iterator(curr);
+	case FULL_SPLAY:
+		splay(node);
+		break;
+	case SEMI_SPLAY:
+		semiSplay(node);
+		break;
+	case DEPTH_SPLAY:
+		if(depth > mStrategyParameter) splay(node);
+		break;
+	case RANDOM_SPLAY:
+		//xorshift32
+		mSeed ^= mSeed << 13;
+		mSeed ^= mSeed >> 17;
+		mSeed ^= mSeed << 5;
+		if(mStrategyParameter <= 1 || mSeed % mStrategyParameter == 0) splay(node);
+		break;
 	}
 }
 
-//finding minimum, use getSmallestNode from bst
-template <typename Key, typename Value>
-typename SplayTree<Key, Value>::iterator SplayTree<Key, Value>::findMin()
+//finding minimum, splays the leftmost node to the root
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::findMin()
 {
-	Node<Key, Value>* curr = BinarySearchTree<Key, Value>::getSmallestNode();
-	splay(curr);
-	return typename SplayTree<Key, Value>::iterator(curr);
+	this->mRoot = splayMin(this->mRoot);
+	if(this->mRoot != nullptr) mMin = this->mRoot;
+	return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(this->mRoot, this);
 }
 
-//keep going right until you hit largest node
-template <typename Key, typename Value>
-typename SplayTree<Key, Value>::iterator SplayTree<Key, Value>::findMax()
+//finding maximum, splays the rightmost node to the root
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::findMax()
 {
-	Node<Key, Value>* curr = this->mRoot;
+	this->mRoot = splayMax(this->mRoot);
+	if(this->mRoot != nullptr) mMax = this->mRoot;
+	return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(this->mRoot, this);
+}
 
-	while(curr->getRight())
-		curr = curr->getRight();
-	splay(curr);
-	return typename SplayTree<Key, Value>::iterator(curr);
+/**
+* Splits the tree at key: keys smaller than key stay in this tree and the rest move to right, whose old
+* contents are cleared first. Costs one splay, amortized O(log n). Both trees must use equal allocators
+* (e.g. construct right with get_allocator()), since nodes move between them.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::split(const Key& key, SplayTree<Key, Value, NodeType, Alloc, Compare>& right)
+{
+	checkCompatible(right);
+	right.clear();
+	right.mRoot = detachFrom(key);
+	mFinger = nullptr;
+	//a known extreme stays known in whichever tree its node went to
+	if(mMin != nullptr && this->compareKeys(mMin->getKey(), key) >= 0)
+	{
+		right.mMin = mMin;
+		mMin = nullptr;
+	}
+	if(mMax != nullptr && this->compareKeys(mMax->getKey(), key) >= 0) right.mMax = mMax;
+	mMax = nullptr;
 }
 
-//delete the minimum leaf 
-template <typename Key, typename Value>
-void SplayTree<Key, Value>::deleteMinLeaf()
+/**
+* Moves every node of right into this tree and leaves right empty. All keys in this tree must precede
+* all keys in right, otherwise std::invalid_argument is thrown and both trees keep their contents. Costs two
+* splays, amortized O(log n). Both trees must use equal allocators.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::join(SplayTree<Key, Value, NodeType, Alloc, Compare>& right)
 {
-	Node<Key, Value>* curr = this->mRoot;
+	checkCompatible(right);
+	if(right.mRoot == nullptr || &right == this) return;
+	if(this->mRoot != nullptr)
+	{
+		this->mRoot = splayMax(this->mRoot);
+		right.mRoot = right.splayMin(right.mRoot);
+		if(this->compareKeys(this->mRoot->getKey(), right.mRoot->getKey()) >= 0)
+		{
+			throw std::invalid_argument("join: keys of the left tree must precede the right tree");
+		}
+	}
+	attachGreater(right.mRoot);
+	mMax = right.mMax;
+	right.mRoot = nullptr;
+	right.mFinger = nullptr;
+	right.forgetExtremes();
+}
 
-	if(curr->getLeft() == nullptr && curr->getRight() == nullptr)
+/**
+* Removes every key k with lo <= k < hi. The range is cut out with two splits, freed in one pass and the
+* two outer pieces are joined again, so the cost is amortized O(log n) plus the number of keys freed.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::eraseRange(const Key& lo, const Key& hi)
+{
+	if(this->compareKeys(lo, hi) >= 0) return;
+	//this keeps [.., lo), middle holds [lo, ..)
+	NodeType* middle = detachFrom(lo);
+	NodeType* left = this->mRoot;
+	//cut [hi, ..) off the middle piece
+	this->mRoot = middle;
+	NodeType* right = detachFrom(hi);
+	this->clear_recursive(this->mRoot);
+	this->mRoot = left;
+	attachGreater(right);
+	mFinger = nullptr;
+	forgetExtremes();
+}
+
+/**
+* Adds every item of other to this tree, the value from other winning for keys in both, and leaves other
+* empty. Only the smaller of the two trees, of m keys, is rebalanced; its root splits the larger one, of
+* n keys, by a splay, the two halves are merged with its two subtrees in parallel on up to threads
+* threads (0 means the hardware concurrency), and its root joins the results. Every split is a splay of a
+* piece of the larger tree, so that tree is never walked as a whole: O(m log n) amortized work, and a
+* 10-key tree merges into a 10M-key one in about as many steps as 10 inserts. The recursion follows the
+* rebalanced smaller tree, O(log m) deep. Both trees must use equal allocators.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::unionWith(SplayTree<Key, Value, NodeType, Alloc, Compare>& other, std::size_t threads)
+{
+	checkCompatible(other);
+	if(&other == this) return;
+	std::vector<NodeType*> garbage;
+	if(smallerTree(other.mRoot, this->mRoot))
+	{
+		other.rebalance();
+		this->mRoot = unionNodes(this->mRoot, other.mRoot, true, garbage, forkDepth(threads));
+	}
+	else
+	{
+		this->rebalance();
+		this->mRoot = unionNodes(other.mRoot, this->mRoot, false, garbage, forkDepth(threads));
+	}
+	other.mRoot = nullptr;
+	other.mFinger = nullptr;
+	other.forgetExtremes();
+	mFinger = nullptr;
+	forgetExtremes();
+	for(std::size_t i = 0; i < garbage.size(); i++) this->destroyNode(garbage[i]);
+}
+
+/**
+* Keeps only the keys that are also in other, with this tree's values, in the same way as unionWith and
+* with the same cost. other keeps its items, though it is rebalanced if it is the smaller tree and
+* reshaped by splays otherwise.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::intersectWith(SplayTree<Key, Value, NodeType, Alloc, Compare>& other, std::size_t threads)
+{
+	if(&other == this) return;
+	std::vector<NodeType*> garbage;
+	if(smallerTree(other.mRoot, this->mRoot))
+	{
+		other.rebalance();
+		this->mRoot = filterNodes(this->mRoot, other.mRoot, true, garbage, forkDepth(threads));
+	}
+	else
 	{
-		delete curr;
-		this->mRoot == nullptr;
+		this->rebalance();
+		this->mRoot = filterByNodes(this->mRoot, other.mRoot, true, garbage, forkDepth(threads), &other.mRoot);
+	}
+	mFinger = nullptr;
+	forgetExtremes();
+	for(std::size_t i = 0; i < garbage.size(); i++) this->destroyNode(garbage[i]);
+}
+
+/**
+* Removes every key that is also in other, in the same way as unionWith and with the same cost. other
+* keeps its items, though it is rebalanced if it is the smaller tree and reshaped by splays otherwise.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::differenceWith(SplayTree<Key, Value, NodeType, Alloc, Compare>& other, std::size_t threads)
+{
+	if(&other == this)
+	{
+		clear();
 		return;
 	}
-	//go left until nullptr and then go right  
-	while(curr->getLeft() != nullptr || curr->getRight() != nullptr)
+	std::vector<NodeType*> garbage;
+	if(smallerTree(other.mRoot, this->mRoot))
 	{
-		if(curr->getLeft() != nullptr)
+		other.rebalance();
+		this->mRoot = filterNodes(this->mRoot, other.mRoot, false, garbage, forkDepth(threads));
+	}
+	else
+	{
+		this->rebalance();
+		this->mRoot = filterByNodes(this->mRoot, other.mRoot, false, garbage, forkDepth(threads), &other.mRoot);
+	}
+	mFinger = nullptr;
+	forgetExtremes();
+	for(std::size_t i = 0; i < garbage.size(); i++) this->destroyNode(garbage[i]);
+}
+
+/**
+* Inserts the key/value pairs in [first, last), which should be sorted by key, and returns how many keys
+* were new (existing keys have their value overwritten). Instead of a splay per key, the batch is merged
+* into the tree: each key is searched from the node the previous one ended on (see locateFrom), and a run
+* of new keys that all fall into the same gap between existing keys is built into a balanced subtree and
+* hung into that gap in one go. The last node touched is splayed once at the end.
+*
+* Unsorted input is still inserted correctly, it just gets shorter runs and longer searches.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template <typename ForwardIt>
+std::size_t SplayTree<Key, Value, NodeType, Alloc, Compare>::insertBatch(ForwardIt first, ForwardIt last)
+{
+	std::size_t inserted = 0;
+	NodeType* curr = nullptr;
+	//runs are hung in without comparing against the extremes
+	forgetExtremes();
+	while(first != last)
+	{
+		int c = 1;
+		NodeType* upper = nullptr;
+		if(this->mRoot != nullptr)
+		{
+			curr = locateFrom(curr, first->first, &c);
+			if(c == 0)
+			{
+				//key already in the tree, overwrite the value
+				curr->setValue(first->second);
+				this->recomputeUpward(curr);
+				++first;
+				continue;
+			}
+			//the gap ends at curr, or at the first ancestor curr is left of
+			if(c < 0) upper = curr;
+			else
+			{
+				upper = curr;
+				while(upper->getParent() != nullptr && upper->getParent()->getRight() == upper) upper = upper->getParent();
+				upper = upper->getParent();
+			}
+		}
+		//the run: strictly increasing keys that all fit in the gap
+		std::size_t n = 1;
+		ForwardIt prev = first;
+		for(ForwardIt it = std::next(first); it != last; prev = it++, n++)
 		{
-			curr = curr->getLeft();
+			if(this->compareKeys(prev->first, it->first) >= 0) break;
+			if(upper != nullptr && this->compareKeys(it->first, upper->getKey()) >= 0) break;
 		}
+		NodeType* run = this->buildBalanced(first, n, this->mRoot != nullptr ? curr : nullptr);
+		if(this->mRoot == nullptr) this->mRoot = run;
 		else
 		{
-			curr = curr->getRight();
+			if(c < 0) curr->setLeft(run);
+			else curr->setRight(run);
+			this->recomputeUpward(curr);
 		}
+		inserted += n;
+		curr = run;
+	}
+	if(curr != nullptr)
+	{
+		splay(curr);
+		mFinger = curr;
 	}
+	return inserted;
+}
 
-	//set pointer equal to the temp parent 
-	Node<Key, Value>* temp_parent = curr->getParent();
-	if(curr->getParent()->getRight() == curr)
+/**
+* Looks up the keys in [first, last), which should be sorted, and writes one iterator per key to out (the
+* end iterator for keys that are missing). Returns out advanced past the results. Each key is searched
+* from the node the previous one ended on, so nearby keys cost little, and only the last node reached is
+* splayed.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template <typename InputIt, typename OutputIt>
+OutputIt SplayTree<Key, Value, NodeType, Alloc, Compare>::findBatch(InputIt first, InputIt last, OutputIt out)
+{
+	NodeType* curr = nullptr;
+	for(; first != last; ++first, ++out)
 	{
-		delete curr->getParent()->getRight();
-		temp_parent->setRight(nullptr);
+		if(this->mRoot == nullptr)
+		{
+			*out = typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(nullptr, this);
+			continue;
+		}
+		int c;
+		curr = locateFrom(curr, *first, &c);
+		*out = typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(c == 0 ? curr : nullptr, this);
 	}
-	else 
+	if(curr != nullptr)
 	{
-		delete curr->getParent()->getLeft();
-		temp_parent->setLeft(nullptr);
+		splay(curr);
+		mFinger = curr;
 	}
-	//REMEMBER TO SPLAY 
-	splay(temp_parent);
+	return out;
 }
 
-//delete max leaf 
-template <typename Key, typename Value>
-void SplayTree<Key, Value>::deleteMaxLeaf()
+/**
+* Looks up the keys in [first, last), in any order, and writes one iterator per key to out (the end
+* iterator for keys that are missing). Returns out advanced past the results. The descents do not splay
+* and run interleaved, several at a time, so their cache misses overlap; this is the call for a batch of
+* unrelated keys on a tree much larger than the cache, where findBatch has no locality to exploit. With
+* splayResults set, the nodes found are splayed afterwards in input order, so the tree adapts to the
+* batch as a loop of find would.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template <typename ForwardIt, typename OutputIt>
+OutputIt SplayTree<Key, Value, NodeType, Alloc, Compare>::multiFind(ForwardIt first, ForwardIt last, OutputIt out, bool splayResults)
 {
-	Node<Key, Value>* curr = this->mRoot;
+	this->interleavedFind(first, last, [this, &out, splayResults](NodeType* node) {
+		*out = typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(node, this);
+		++out;
+		if(splayResults && node != nullptr)
+		{
+			splay(node);
+			mFinger = node;
+		}
+	});
+	return out;
+}
 
-	if(curr->getLeft() == nullptr && curr->getRight() == nullptr)
+/**
+* Removes the keys in [first, last), which should be sorted, and returns how many were present. Each key
+* is searched from where the previous removal left off and unlinked without splaying; the last node
+* touched is splayed once at the end.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template <typename InputIt>
+std::size_t SplayTree<Key, Value, NodeType, Alloc, Compare>::eraseBatch(InputIt first, InputIt last)
+{
+	std::size_t erased = 0;
+	NodeType* curr = nullptr;
+	mFinger = nullptr;
+	forgetExtremes();
+	for(; first != last && this->mRoot != nullptr; ++first)
 	{
-		delete curr;
-		this->mRoot == nullptr;
+		int c;
+		curr = locateFrom(curr, *first, &c);
+		if(c != 0) continue;
+		if(curr->getLeft() != nullptr && curr->getRight() != nullptr) this->swapWithPredecessor(curr);
+		//carry on from the parent, or from the root if the root went
+		curr = this->spliceOut(curr);
+		this->recomputeUpward(curr);
+		erased++;
+	}
+	if(curr != nullptr)
+	{
+		splay(curr);
+		mFinger = curr;
+	}
+	return erased;
+}
+
+//number of keys in the tree, needs a sized node type such as SizedSplayNode
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+std::size_t SplayTree<Key, Value, NodeType, Alloc, Compare>::size() const
+{
+	return subtreeSize(this->mRoot);
+}
+
+/**
+* Returns an iterator to the k-th smallest key (counting from 0), or the end iterator if the tree holds
+* k keys or fewer. The node is found by subtree sizes in one top-down splay, so it ends up at the root.
+* Needs a sized node type such as SizedSplayNode.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::select(std::size_t k)
+{
+	if(k >= subtreeSize(this->mRoot)) return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(nullptr, this);
+	//k counts down as the descent skips over smaller keys
+	this->mRoot = splayTopDown(this->mRoot, [&k](const NodeType* n) {
+		std::size_t left = subtreeSize(n->getLeft());
+		if(k < left) return -1;
+		if(k == left) return 0;
+		k -= left + 1;
+		return 1;
+	});
+	return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(this->mRoot, this);
+}
+
+/**
+* Returns the number of keys smaller than key, whether or not key itself is in the tree. Splays key like
+* find does. Needs a sized node type such as SizedSplayNode.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+std::size_t SplayTree<Key, Value, NodeType, Alloc, Compare>::rank(const Key& key)
+{
+	if(this->mRoot == nullptr) return 0;
+	int order;
+	this->mRoot = splayKey(this->mRoot, key, &order);
+	//everything left of the root is smaller, and so is the root if key lies past it
+	return subtreeSize(this->mRoot->getLeft()) + (order > 0 ? 1 : 0);
+}
+
+/**
+* Returns the number of keys k with lo <= k < hi, the same range eraseRange removes. Costs two splays.
+* Needs a sized node type such as SizedSplayNode.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+std::size_t SplayTree<Key, Value, NodeType, Alloc, Compare>::countRange(const Key& lo, const Key& hi)
+{
+	if(this->compareKeys(lo, hi) >= 0) return 0;
+	std::size_t below = rank(lo);
+	return rank(hi) - below;
+}
+
+/**
+* Combines the values of every key k with lo <= k < hi, in key order, under the node type's monoid (see
+* AggregateSplayNode), and returns the monoid's identity for an empty range. hi is splayed to the root
+* and lo to the root of its left subtree, which leaves the range as that node's right subtree plus the
+* two splayed nodes themselves, so the cost is two splays, amortized O(log n).
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+Value SplayTree<Key, Value, NodeType, Alloc, Compare>::aggregate(const Key& lo, const Key& hi)
+{
+	typedef typename NodeType::monoid_type Monoid;
+	Value result = Monoid::identity();
+	if(this->mRoot == nullptr || this->compareKeys(lo, hi) >= 0) return result;
+	int hiOrder;
+	NodeType* root = splayKey(this->mRoot, hi, &hiOrder);
+	this->mRoot = root;
+	//everything < hi is now in the left subtree, plus the root if hi lies past it
+	NodeType* left = root->getLeft();
+	if(left != nullptr)
+	{
+		int loOrder;
+		left = splayKey(left, lo, &loOrder);
+		root->setLeft(left);
+		left->setParent(root);
+		if(loOrder <= 0) result = Monoid::combine(result, left->getValue());
+		if(left->getRight() != nullptr) result = Monoid::combine(result, left->getRight()->getAggregate());
+	}
+	if(hiOrder > 0 && this->compareKeys(lo, root->getKey()) <= 0)
+	{
+		result = Monoid::combine(result, root->getValue());
+	}
+	return result;
+}
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+std::size_t SplayTree<Key, Value, NodeType, Alloc, Compare>::subtreeSize(const NodeType* node)
+{
+	return node == nullptr ? 0 : node->getSize();
+}
+
+/**
+* Splays key and cuts the tree in two. The tree keeps the keys smaller than key and the root of the
+* rest is returned with no parent.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::detachFrom(const Key& key)
+{
+	if(this->mRoot == nullptr) return nullptr;
+	int order;
+	NodeType* root = splayKey(this->mRoot, key, &order);
+	NodeType* right;
+	if(order <= 0)
+	{
+		//the root and its right subtree are >= key
+		right = root;
+		this->mRoot = root->getLeft();
+		root->setLeft(nullptr);
+	}
+	else
+	{
+		//the root is < key, only its right subtree moves
+		right = root->getRight();
+		this->mRoot = root;
+		root->setRight(nullptr);
+	}
+	root->recompute();
+	if(this->mRoot != nullptr) this->mRoot->setParent(nullptr);
+	if(right != nullptr) right->setParent(nullptr);
+	return right;
+}
+
+/**
+* Hangs a tree whose keys all follow this tree's keys off the maximum of this tree.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::attachGreater(NodeType* right)
+{
+	if(right == nullptr) return;
+	if(this->mRoot == nullptr)
+	{
+		this->mRoot = right;
 		return;
 	}
+	//the max of this tree has no right child once splayed
+	this->mRoot = splayMax(this->mRoot);
+	this->mRoot->setRight(right);
+	right->setParent(this->mRoot);
+	this->mRoot->recompute();
+}
 
-	//go right until nullptr then go left
-	while(curr->getLeft() != nullptr || curr->getRight() != nullptr)
+//nodes can only move between trees that free them the same way
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::checkCompatible(const SplayTree<Key, Value, NodeType, Alloc, Compare>& other) const
+{
+	if(!(this->mAlloc == other.mAlloc))
 	{
-		if(curr->getRight() != nullptr)
+		throw std::invalid_argument("trees must use equal allocators to exchange nodes");
+	}
+}
+
+/**
+* Whether the tree at a has at most as many nodes as the tree at b. Both are walked in order side by side
+* until one runs out, so this costs O(min(n, m)) rather than a count of the larger tree.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+bool SplayTree<Key, Value, NodeType, Alloc, Compare>::smallerTree(NodeType* a, NodeType* b)
+{
+	if(a != nullptr)
+	{
+		while(a->getLeft() != nullptr) a = a->getLeft();
+	}
+	if(b != nullptr)
+	{
+		while(b->getLeft() != nullptr) b = b->getLeft();
+	}
+	while(a != nullptr && b != nullptr)
+	{
+		a = BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::successor(a);
+		b = BinarySearchTree<Key, Value, NodeType, Alloc, Compare>::successor(b);
+	}
+	return a == nullptr;
+}
+
+/**
+* Splits the subtree at root into the nodes below key, the node equal to it (or nullptr) and the nodes
+* above it, by splaying key to the top of the subtree first. All three come back with no parent.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::splitNodes(NodeType* root, const Key& key, NodeType** less, NodeType** equal, NodeType** greater)
+{
+	*less = nullptr;
+	*equal = nullptr;
+	*greater = nullptr;
+	if(root == nullptr) return;
+	int order;
+	root = splayKey(root, key, &order);
+	if(order == 0)
+	{
+		*less = root->getLeft();
+		*greater = root->getRight();
+		*equal = root;
+		root->setLeft(nullptr);
+		root->setRight(nullptr);
+	}
+	else if(order < 0)
+	{
+		//the root and its right subtree are above key
+		*less = root->getLeft();
+		*greater = root;
+		root->setLeft(nullptr);
+	}
+	else
+	{
+		*less = root;
+		*greater = root->getRight();
+		root->setRight(nullptr);
+	}
+	root->recompute();
+	if(*less != nullptr) (*less)->setParent(nullptr);
+	if(*greater != nullptr) (*greater)->setParent(nullptr);
+}
+
+//hangs left and right, which must be on either side of middle's key, under middle
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::joinNodes(NodeType* left, NodeType* middle, NodeType* right)
+{
+	middle->setLeft(left);
+	middle->setRight(right);
+	middle->setParent(nullptr);
+	if(left != nullptr) left->setParent(middle);
+	if(right != nullptr) right->setParent(middle);
+	middle->recompute();
+	return middle;
+}
+
+//joins two subtrees, all keys of left first, under the largest node of left once it is splayed to the top
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::joinNodes(NodeType* left, NodeType* right)
+{
+	if(left == nullptr) return right;
+	if(right == nullptr) return left;
+	NodeType* max = splayMax(left);
+	return joinNodes(max->getLeft(), max, right);
+}
+
+/**
+* Merges subtree b into subtree a (see unionWith): b's root splits a, and for a key in both the node of
+* b is kept if bWins and the node of a otherwise. The losing node is added to garbage rather than freed,
+* since the allocator need not be thread-safe. The two halves fork while depth is above zero; they touch
+* disjoint nodes.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::unionNodes(NodeType* a, NodeType* b, bool bWins, std::vector<NodeType*>& garbage, std::size_t depth)
+{
+	if(a == nullptr) return b;
+	if(b == nullptr) return a;
+	NodeType* bLeft = b->getLeft();
+	NodeType* bRight = b->getRight();
+	if(bLeft != nullptr) bLeft->setParent(nullptr);
+	if(bRight != nullptr) bRight->setParent(nullptr);
+	NodeType* aLess;
+	NodeType* aEqual;
+	NodeType* aGreater;
+	splitNodes(a, b->getKey(), &aLess, &aEqual, &aGreater);
+	NodeType* middle = b;
+	if(aEqual != nullptr && !bWins)
+	{
+		middle = aEqual;
+		garbage.push_back(b);
+	}
+	else if(aEqual != nullptr) garbage.push_back(aEqual);
+	NodeType* left = nullptr;
+	NodeType* right = nullptr;
+	std::vector<NodeType*> forkedGarbage;
+	std::size_t next = depth > 0 ? depth - 1 : 0;
+	forkJoin([&]() { left = unionNodes(aLess, bLeft, bWins, forkedGarbage, next); },
+		[&]() { right = unionNodes(aGreater, bRight, bWins, garbage, next); }, depth > 0);
+	garbage.insert(garbage.end(), forkedGarbage.begin(), forkedGarbage.end());
+	return joinNodes(left, middle, right);
+}
+
+/**
+* Keeps the nodes of subtree a whose key is (keepCommon) or is not (otherwise) in subtree b, which is
+* only read. b's root splits a, so b should be the smaller, balanced side. Dropped nodes go to garbage.
+* Forks like unionNodes.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::filterNodes(NodeType* a, const NodeType* b, bool keepCommon, std::vector<NodeType*>& garbage, std::size_t depth)
+{
+	if(a == nullptr) return nullptr;
+	if(b == nullptr)
+	{
+		if(!keepCommon) return a;
+		//nothing in a can match, so all of it goes
+		std::size_t first = garbage.size();
+		garbage.push_back(a);
+		for(std::size_t i = first; i < garbage.size(); i++)
 		{
-			curr = curr->getRight();
+			if(garbage[i]->getLeft() != nullptr) garbage.push_back(garbage[i]->getLeft());
+			if(garbage[i]->getRight() != nullptr) garbage.push_back(garbage[i]->getRight());
 		}
-		else
+		return nullptr;
+	}
+	NodeType* aLess;
+	NodeType* aEqual;
+	NodeType* aGreater;
+	splitNodes(a, b->getKey(), &aLess, &aEqual, &aGreater);
+	NodeType* left = nullptr;
+	NodeType* right = nullptr;
+	std::vector<NodeType*> forkedGarbage;
+	std::size_t next = depth > 0 ? depth - 1 : 0;
+	forkJoin([&]() { left = filterNodes(aLess, b->getLeft(), keepCommon, forkedGarbage, next); },
+		[&]() { right = filterNodes(aGreater, b->getRight(), keepCommon, garbage, next); }, depth > 0);
+	garbage.insert(garbage.end(), forkedGarbage.begin(), forkedGarbage.end());
+	if(aEqual != nullptr && keepCommon) return joinNodes(left, aEqual, right);
+	if(aEqual != nullptr) garbage.push_back(aEqual);
+	return joinNodes(left, right);
+}
+
+/**
+* filterNodes the other way round, for when a is the smaller, balanced side: a's root splits b, and b's
+* pieces are joined again on the way back, so b keeps all of its nodes and comes back in restored.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::filterByNodes(NodeType* a, NodeType* b, bool keepCommon, std::vector<NodeType*>& garbage, std::size_t depth, NodeType** restored)
+{
+	if(a == nullptr || b == nullptr)
+	{
+		*restored = b;
+		return filterNodes(a, b, keepCommon, garbage, depth);
+	}
+	NodeType* aLeft = a->getLeft();
+	NodeType* aRight = a->getRight();
+	if(aLeft != nullptr) aLeft->setParent(nullptr);
+	if(aRight != nullptr) aRight->setParent(nullptr);
+	NodeType* bLess;
+	NodeType* bEqual;
+	NodeType* bGreater;
+	splitNodes(b, a->getKey(), &bLess, &bEqual, &bGreater);
+	NodeType* left = nullptr;
+	NodeType* right = nullptr;
+	NodeType* bLeft = nullptr;
+	NodeType* bRight = nullptr;
+	std::vector<NodeType*> forkedGarbage;
+	std::size_t next = depth > 0 ? depth - 1 : 0;
+	forkJoin([&]() { left = filterByNodes(aLeft, bLess, keepCommon, forkedGarbage, next, &bLeft); },
+		[&]() { right = filterByNodes(aRight, bGreater, keepCommon, garbage, next, &bRight); }, depth > 0);
+	garbage.insert(garbage.end(), forkedGarbage.begin(), forkedGarbage.end());
+	*restored = bEqual != nullptr ? joinNodes(bLeft, bEqual, bRight) : joinNodes(bLeft, bRight);
+	if((bEqual != nullptr) == keepCommon) return joinNodes(left, a, right);
+	garbage.push_back(a);
+	return joinNodes(left, right);
+}
+
+//removes the leaf reached by going left where possible and splays its parent
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::deleteMinLeaf()
+{
+	NodeType* leaf = this->getMinLeaf();
+	if(leaf == nullptr) return;
+	mFinger = nullptr;
+	forgetNode(leaf);
+	NodeType* parent = this->spliceOut(leaf);
+	this->recomputeUpward(parent);
+	splay(parent);
+}
+
+//the mirror image of deleteMinLeaf
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::deleteMaxLeaf()
+{
+	NodeType* leaf = this->getMaxLeaf();
+	if(leaf == nullptr) return;
+	mFinger = nullptr;
+	forgetNode(leaf);
+	NodeType* parent = this->spliceOut(leaf);
+	this->recomputeUpward(parent);
+	splay(parent);
+}
+
+/**
+* Returns an iterator to the smallest item, or the end iterator if the tree is empty, without
+* restructuring the tree. The node is cached, so this is O(1) except for the first call after an
+* operation that lost track of it (such as remove of the smallest key, split or eraseRange), which walks
+* down the left spine once.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::peekMin()
+{
+	return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(cachedMin(), this);
+}
+
+//the mirror image of peekMin
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::peekMax()
+{
+	return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(cachedMax(), this);
+}
+
+/**
+* Removes the smallest item, if there is one. The cached node has no left child, so it is unlinked in
+* place and its successor, the leftmost node of its right subtree or else its parent, becomes the cached
+* minimum. Nothing is rotated: like an in-order walk, a run of pops visits each node about twice, so a
+* pop is O(1) amortized and O(1) outright when the minimum is the root. With an augmented node type the
+* ancestors' data must be redone, and the successor is splayed to the root, which does that and pays for
+* the walk, for O(log n) amortized.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::popMin()
+{
+	NodeType* node = cachedMin();
+	if(node == nullptr) return;
+	NodeType* parent = node->getParent();
+	NodeType* right = node->getRight();
+	if(right != nullptr) right->setParent(parent);
+	if(parent == nullptr) this->mRoot = right;
+	else parent->setLeft(right);
+	if(mFinger == node) mFinger = nullptr;
+	if(mMax == node) mMax = nullptr;
+	this->destroyNode(node);
+	NodeType* next = parent;
+	if(right != nullptr)
+	{
+		next = right;
+		while(next->getLeft() != nullptr) next = next->getLeft();
+	}
+	mMin = next;
+	if(NodeType::AUGMENTED)
+	{
+		if(parent != nullptr) parent->recompute();
+		splay(next);
+	}
+}
+
+//the mirror image of popMin
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::popMax()
+{
+	NodeType* node = cachedMax();
+	if(node == nullptr) return;
+	NodeType* parent = node->getParent();
+	NodeType* left = node->getLeft();
+	if(left != nullptr) left->setParent(parent);
+	if(parent == nullptr) this->mRoot = left;
+	else parent->setRight(left);
+	if(mFinger == node) mFinger = nullptr;
+	if(mMin == node) mMin = nullptr;
+	this->destroyNode(node);
+	NodeType* next = parent;
+	if(left != nullptr)
+	{
+		next = left;
+		while(next->getRight() != nullptr) next = next->getRight();
+	}
+	mMax = next;
+	if(NodeType::AUGMENTED)
+	{
+		if(parent != nullptr) parent->recompute();
+		splay(next);
+	}
+}
+
+/**
+* Moves the item handle points at to the smaller key, keeping its value, and returns an iterator to it.
+* The node is re-keyed in place: it is cut out the way remove cuts out the root, given the new key and
+* linked back in the way insert links a new node, so handle and all other iterators stay valid and
+* nothing is allocated or freed. Amortized O(log n).
+*
+* handle must not be the end iterator. Throws std::invalid_argument if it is or if key is greater than
+* the item's key, and the tree is left untouched. Also throws it if key already belongs to another
+* item; the contents are then unchanged, but the tree has been splayed.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator SplayTree<Key, Value, NodeType, Alloc, Compare>::decreaseKey(
+	typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator handle, const Key& key)
+{
+	NodeType* node = this->nodeOf(handle);
+	if(node == nullptr)
+	{
+		throw std::invalid_argument("decreaseKey: the handle is the end iterator");
+	}
+	int c = this->compareKeys(key, node->getKey());
+	if(c > 0)
+	{
+		throw std::invalid_argument("decreaseKey: the new key is greater than the old one");
+	}
+	if(c == 0) return handle;
+	//cut the node out: splayed to the root, its subtrees are joined under the largest node on the left
+	splay(node);
+	NodeType* left = node->getLeft();
+	NodeType* right = node->getRight();
+	NodeType* root = right;
+	if(right != nullptr) right->setParent(nullptr);
+	if(left != nullptr)
+	{
+		left->setParent(nullptr);
+		root = splayMax(left);
+		root->setRight(right);
+		if(right != nullptr) right->setParent(root);
+		root->recompute();
+	}
+	int order = -1;
+	if(root != nullptr) root = splayKey(root, key, &order);
+	try
+	{
+		if(order == 0)
 		{
-			curr = curr->getLeft();
+			throw std::invalid_argument("decreaseKey: the new key is already in the tree");
 		}
+		node->setKey(key);
+		NodeKeyCache<NodeType, Compare>::keyed(node, this->mCompare);
 	}
+	catch(...)
+	{
+		//link the node back in by the key it has
+		if(root != nullptr) root = splayKey(root, node->getKey(), &order);
+		linkRoot(node, root, order);
+		throw;
+	}
+	linkRoot(node, root, order);
+	//the node is the root now, so it is an extreme exactly when it has no child on that side
+	if(node->getLeft() == nullptr) mMin = node;
+	if(mMax == node && node->getRight() != nullptr) mMax = nullptr;
+	return typename SplayTree<Key, Value, NodeType, Alloc, Compare>::iterator(node, this);
+}
 
-	//set pointer equal to the temp parent 
-	Node<Key, Value>* temp_parent = curr->getParent();
-	if(curr->getParent()->getRight() == curr)
+/**
+* The node holding the smallest key, nullptr for an empty tree. Comes from the cache when it is known;
+* otherwise the left spine is walked and the result cached until an operation removes or moves it.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::cachedMin()
+{
+	if(mMin == nullptr && this->mRoot != nullptr)
 	{
-		delete curr->getParent()->getRight();
-		temp_parent->setRight(nullptr);
+		mMin = this->mRoot;
+		while(mMin->getLeft() != nullptr) mMin = mMin->getLeft();
 	}
-	else 
+	return mMin;
+}
+
+//the mirror image of cachedMin
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::cachedMax()
+{
+	if(mMax == nullptr && this->mRoot != nullptr)
 	{
-		delete curr->getParent()->getLeft();
-		temp_parent->setLeft(nullptr);
+		mMax = this->mRoot;
+		while(mMax->getRight() != nullptr) mMax = mMax->getRight();
 	}
-	//REMEMBER TO SPLAY 
-	splay(temp_parent);
+	return mMax;
+}
+
+//drops a cached extreme that is about to be destroyed
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::forgetNode(const NodeType* node)
+{
+	if(mMin == node) mMin = nullptr;
+	if(mMax == node) mMax = nullptr;
+}
+
+//for operations that free or move nodes in bulk
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::forgetExtremes()
+{
+	mMin = nullptr;
+	mMax = nullptr;
 }
 
 //splay function
-template <typename Key, typename Value>
-void SplayTree<Key, Value>::splay(Node<Key, Value> *r)
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::splay(NodeType *r)
 {
 	while(true)
 	{
@@ -257,4 +1475,258 @@ void SplayTree<Key, Value>::splay(Node<Key, Value> *r)
 	}
 }
 
+/**
+* Bottom-up semi-splay. In the zig-zig case only the parent is rotated and the walk goes on from there,
+* so r ends up about halfway to the root and each step costs one rotation instead of two; zig-zag and
+* zig steps are the same as in a full splay.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::semiSplay(NodeType* r)
+{
+	while(r != nullptr && r->getParent() != nullptr)
+	{
+		NodeType* parent = r->getParent();
+		NodeType* grand = parent->getParent();
+		if(grand == nullptr)
+		{
+			rotateUp(r);
+			break;
+		}
+		if((parent->getLeft() == r) == (grand->getLeft() == parent))
+		{
+			rotateUp(parent);
+			r = parent;
+		}
+		else
+		{
+			rotateUp(r);
+			rotateUp(r);
+		}
+	}
+}
+
+//rotates r above its parent, whichever side of it r is on
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::rotateUp(NodeType* r)
+{
+	if(r->getParent()->getLeft() == r) this->rightRotate(r);
+	else this->leftRotate(r);
+}
+
+/**
+* Top-down splay of the subtree rooted at t (Sleator and Tarjan). The search and the restructuring
+* happen in the same descent: nodes passed on the way down are hung off a left tree (keys smaller
+* than the target) and a right tree (keys larger), which are reassembled under the last node reached.
+* Parent pointers are written on the way so the iterator keeps working afterwards. They are only read
+* back when NodeType caches subtree data, to recompute the spines of the left and right trees bottom-up.
+*
+* dir(node) returns a negative number to continue left, a positive number to continue right and 0
+* when the node is the target. It is evaluated exactly once per node visited, after the node's children
+* have been prefetched. The new subtree root is returned with its parent set to nullptr, and if order
+* is given it receives dir(new root).
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template <typename Direction>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::splayTopDown(NodeType* t, Direction dir, int* order)
+{
+	if(t == nullptr) return nullptr;
+	//left tree collects smaller keys along its right spine, right tree larger keys along its left spine
+	NodeType* leftRoot = nullptr;
+	NodeType* leftMax = nullptr;
+	NodeType* rightRoot = nullptr;
+	NodeType* rightMin = nullptr;
+
+	prefetchChildren(t);
+	int d = dir(t);
+	while(d != 0)
+	{
+		if(d < 0)
+		{
+			NodeType* child = t->getLeft();
+			if(child == nullptr) break;
+			prefetchChildren(child);
+			int dc = dir(child);
+			if(dc < 0 && child->getLeft() != nullptr)
+			{
+				//zig-zig: rotate right at t, then hang child on the right tree
+				t->setLeft(child->getRight());
+				if(child->getRight() != nullptr) child->getRight()->setParent(t);
+				child->setRight(t);
+				t->setParent(child);
+				t->recompute();
+				t = child;
+				child = t->getLeft();
+				prefetchChildren(child);
+				dc = dir(child);
+			}
+			else if(dc > 0 && child->getRight() != nullptr)
+			{
+				//zig-zag: t goes to the right tree, child to the left tree
+				if(rightMin != nullptr) rightMin->setLeft(t);
+				else rightRoot = t;
+				t->setParent(rightMin);
+				rightMin = t;
+				if(leftMax != nullptr) leftMax->setRight(child);
+				else leftRoot = child;
+				child->setParent(leftMax);
+				leftMax = child;
+				t = child->getRight();
+				prefetchChildren(t);
+				d = dir(t);
+				continue;
+			}
+			//zig: hang t on the right tree and continue from its left child
+			if(rightMin != nullptr) rightMin->setLeft(t);
+			else rightRoot = t;
+			t->setParent(rightMin);
+			rightMin = t;
+			t = child;
+			d = dc;
+		}
+		else
+		{
+			NodeType* child = t->getRight();
+			if(child == nullptr) break;
+			prefetchChildren(child);
+			int dc = dir(child);
+			if(dc > 0 && child->getRight() != nullptr)
+			{
+				//zag-zag: rotate left at t, then hang child on the left tree
+				t->setRight(child->getLeft());
+				if(child->getLeft() != nullptr) child->getLeft()->setParent(t);
+				child->setLeft(t);
+				t->setParent(child);
+				t->recompute();
+				t = child;
+				child = t->getRight();
+				prefetchChildren(child);
+				dc = dir(child);
+			}
+			else if(dc < 0 && child->getLeft() != nullptr)
+			{
+				//zag-zig: t goes to the left tree, child to the right tree
+				if(leftMax != nullptr) leftMax->setRight(t);
+				else leftRoot = t;
+				t->setParent(leftMax);
+				leftMax = t;
+				if(rightMin != nullptr) rightMin->setLeft(child);
+				else rightRoot = child;
+				child->setParent(rightMin);
+				rightMin = child;
+				t = child->getLeft();
+				prefetchChildren(t);
+				d = dir(t);
+				continue;
+			}
+			//zag: hang t on the left tree and continue from its right child
+			if(leftMax != nullptr) leftMax->setRight(t);
+			else leftRoot = t;
+			t->setParent(leftMax);
+			leftMax = t;
+			t = child;
+			d = dc;
+		}
+	}
+
+	//reassemble: t's subtrees become the innermost children of the left and right trees
+	if(leftRoot != nullptr)
+	{
+		leftMax->setRight(t->getLeft());
+		if(t->getLeft() != nullptr) t->getLeft()->setParent(leftMax);
+		t->setLeft(leftRoot);
+		leftRoot->setParent(t);
+	}
+	if(rightRoot != nullptr)
+	{
+		rightMin->setLeft(t->getRight());
+		if(t->getRight() != nullptr) t->getRight()->setParent(rightMin);
+		t->setRight(rightRoot);
+		rightRoot->setParent(t);
+	}
+	if(NodeType::AUGMENTED)
+	{
+		//only the spines changed below their nodes, and they end at t
+		for(NodeType* n = leftMax; n != nullptr && n != t; n = n->getParent()) n->recompute();
+		for(NodeType* n = rightMin; n != nullptr && n != t; n = n->getParent()) n->recompute();
+		t->recompute();
+	}
+	t->setParent(nullptr);
+	if(order != nullptr) *order = d;
+	return t;
+}
+
+/**
+* Makes node the root of the tree, above root, which must have been splayed on node's key with order the
+* result (nullptr for an empty tree). root's subtree on node's side moves under node.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void SplayTree<Key, Value, NodeType, Alloc, Compare>::linkRoot(NodeType* node, NodeType* root, int order)
+{
+	node->setParent(nullptr);
+	node->setLeft(nullptr);
+	node->setRight(nullptr);
+	if(root != nullptr)
+	{
+		if(order < 0)
+		{
+			node->setLeft(root->getLeft());
+			if(root->getLeft() != nullptr) root->getLeft()->setParent(node);
+			root->setLeft(nullptr);
+			node->setRight(root);
+		}
+		else
+		{
+			node->setRight(root->getRight());
+			if(root->getRight() != nullptr) root->getRight()->setParent(node);
+			root->setRight(nullptr);
+			node->setLeft(root);
+		}
+		root->setParent(node);
+		root->recompute();
+	}
+	node->recompute();
+	this->mRoot = node;
+	mFinger = node;
+}
+
+//top-down splay towards key, ends on the key's node or the last node on its search path
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+template <typename K>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::splayKey(NodeType* t, const K& key, int* order)
+{
+	NodeProbe<NodeType, K, Compare> probe(key, this->mCompare);
+	const Compare& comp = this->mCompare;
+	//the splay relinks every node it compares against, so it may as well bring their key caches up to date
+	return splayTopDown(t, [&probe, &comp](NodeType* n) {
+		NodeKeyCache<NodeType, Compare>::refresh(n, comp);
+		return probe.compare(n);
+	}, order);
+}
+
+//top-down splay of the leftmost node
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::splayMin(NodeType* t)
+{
+	return splayTopDown(t, [](const NodeType*) { return -1; });
+}
+
+//top-down splay of the rightmost node
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+NodeType* SplayTree<Key, Value, NodeType, Alloc, Compare>::splayMax(NodeType* t)
+{
+	return splayTopDown(t, [](const NodeType*) { return 1; });
+}
+
+#if defined(__has_include) && __cplusplus >= 201703L
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+
+/**
+* A SplayTree whose nodes come from a std::pmr::memory_resource, so several trees can share one.
+*/
+template <typename Key, typename Value, typename NodeType = SplayNode<Key, Value> >
+using PmrSplayTree = SplayTree<Key, Value, NodeType, std::pmr::polymorphic_allocator<std::pair<const Key, Value> > >;
+#endif
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,486 @@
+#ifndef STRING_KEY_NODE_H
+#define STRING_KEY_NODE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include "splayTree.h"
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+/**
+* What a tree of StringKeyNode knows about its keys: the length of the prefix that every key inserted so
+* far has in common, and the first of those keys to check others against. Cached prefixes are taken
+* right after the common part, since bytes that every key shares cannot tell two keys apart (every URL
+* starts with "https://"). Only node creation writes it; lookups just read it.
+*
+* The stamp names the anchor, which never changes once set, so a window taken against one anchor is
+* never mistaken for one taken against another. Zero means no anchor yet.
+*/
+struct StringKeyContext
+{
+	StringKeyContext();
+
+	static uint32_t nextStamp();
+
+	std::string anchor;
+	std::size_t skip;
+	uint32_t stamp;
+};
+
+/**
+* The byte-wise ordering of std::string, for trees built from StringKeyNode. It carries the tree's
+* StringKeyContext by value, so a copied tree has a context of its own.
+*/
+class StringKeyLess
+{
+public:
+	StringKeyLess();
+
+#if __cplusplus >= 201703L
+	typedef void is_transparent;
+	bool operator()(std::string_view a, std::string_view b) const;
+#else
+	bool operator()(const std::string& a, const std::string& b) const;
+#endif
+	const StringKeyContext& context() const;
+	StringKeyContext& context();
+
+private:
+	StringKeyContext mContext;
+};
+
+/**
+* A splay tree node for std::string keys. The hot part holds the links and an 8-byte big-endian window
+* of the key taken at the tree's common prefix length, so most comparisons during a descent are a single
+* integer compare that never touches the string or its heap buffer. The item sits right after the links,
+* so a descent that does need the key finds the std::string header on the same cache line or the next one
+* instead of behind another pointer.
+*
+* The window is taken when the node gets its key and remembers the common prefix length it was taken at.
+* When that length shrinks the window is stale, and descents through the node fall back to a full
+* compare until a splay passes by and takes it again.
+*/
+template <typename Value>
+class StringKeyNode
+{
+public:
+	static const bool AUGMENTED = false;
+
+	static const uint32_t NO_PREFIX = 0xFFFFFFFFu;
+
+	StringKeyNode(const std::string& key, const Value& value, StringKeyNode<Value>* parent);
+
+	const std::pair<const std::string, Value>& getItem() const;
+	std::pair<const std::string, Value>& getItem();
+	const std::string& getKey() const;
+	const Value& getValue() const;
+	Value& getValue();
+
+	StringKeyNode<Value>* getParent() const;
+	StringKeyNode<Value>* getLeft() const;
+	StringKeyNode<Value>* getRight() const;
+
+	void setParent(StringKeyNode<Value>* parent);
+	void setLeft(StringKeyNode<Value>* left);
+	void setRight(StringKeyNode<Value>* right);
+	void setKey(const std::string& key);
+	void setValue(const Value &value);
+	void recompute();
+	void copyBalance(const StringKeyNode<Value>& other);
+
+	uint64_t getPrefix() const;
+	uint32_t getPrefixSkip() const;
+	uint32_t getPrefixStamp() const;
+	void cachePrefix(uint64_t prefix, uint32_t skip, uint32_t stamp);
+
+protected:
+	uint64_t mPrefix;
+	uint32_t mPrefixSkip;
+	uint32_t mPrefixStamp;
+	StringKeyNode<Value>* mParent;
+	StringKeyNode<Value>* mLeft;
+	StringKeyNode<Value>* mRight;
+	std::pair<const std::string, Value> mItem;
+
+private:
+	StringKeyNode(const StringKeyNode& other);
+	StringKeyNode& operator=(const StringKeyNode& other);
+};
+
+/**
+* A SplayTree keyed by std::string that compares through cached key prefixes. The public interface is
+* the same as SplayTree's.
+*/
+template <typename Value>
+using StringSplayTree = SplayTree<std::string, Value, StringKeyNode<Value>,
+	std::allocator<std::pair<const std::string, Value> >, StringKeyLess>;
+
+/*
+	----------------------------------------------
+	Begin implementations for the key byte helpers.
+	----------------------------------------------
+*/
+
+inline std::pair<const char*, std::size_t> stringKeyBytes(const std::string& key)
+{
+	return std::make_pair(key.data(), key.size());
+}
+
+inline std::pair<const char*, std::size_t> stringKeyBytes(const char* key)
+{
+	return std::make_pair(key, std::strlen(key));
+}
+
+#if __cplusplus >= 201703L
+inline std::pair<const char*, std::size_t> stringKeyBytes(std::string_view key)
+{
+	return std::make_pair(key.data(), key.size());
+}
+#endif
+
+/**
+* The 8 bytes of a key starting at skip, big-endian and zero padded. Padding with the smallest byte
+* keeps the order: if two windows differ, the keys differ the same way.
+*/
+inline uint64_t stringKeyPrefix(const char* data, std::size_t size, std::size_t skip)
+{
+	unsigned char bytes[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	if(skip < size) std::memcpy(bytes, data + skip, std::min<std::size_t>(size - skip, 8));
+	uint64_t prefix = 0;
+	for(int i = 0; i < 8; i++) prefix = (prefix << 8) | bytes[i];
+	return prefix;
+}
+
+//the number of leading bytes two keys share, counting no further than limit
+inline std::size_t stringKeyCommon(const char* a, std::size_t aSize, const char* b, std::size_t bSize, std::size_t limit)
+{
+	limit = std::min(limit, std::min(aSize, bSize));
+	std::size_t common = 0;
+	while(common < limit && a[common] == b[common]) common++;
+	return common;
+}
+
+//three-way byte-wise comparison, the same order as std::string::compare
+inline int stringKeyCompare(const char* a, std::size_t aSize, const char* b, std::size_t bSize)
+{
+	int c = std::memcmp(a, b, std::min(aSize, bSize));
+	if(c != 0) return c;
+	if(aSize < bSize) return -1;
+	if(aSize > bSize) return 1;
+	return 0;
+}
+
+/*
+	--------------------------------------------
+	End implementations for the key byte helpers.
+	--------------------------------------------
+*/
+
+/*
+	------------------------------------------------------------------
+	Begin implementations for the StringKeyContext/StringKeyLess class.
+	------------------------------------------------------------------
+*/
+
+inline StringKeyContext::StringKeyContext()
+	: skip(0)
+	, stamp(0)
+{
+
+}
+
+//a stamp no other anchor has, never zero
+inline uint32_t StringKeyContext::nextStamp()
+{
+	static std::atomic<uint32_t> last(0);
+	uint32_t stamp = ++last;
+	while(stamp == 0) stamp = ++last;
+	return stamp;
+}
+
+inline StringKeyLess::StringKeyLess()
+{
+
+}
+
+#if __cplusplus >= 201703L
+inline bool StringKeyLess::operator()(std::string_view a, std::string_view b) const
+{
+	return a < b;
+}
+#else
+inline bool StringKeyLess::operator()(const std::string& a, const std::string& b) const
+{
+	return a < b;
+}
+#endif
+
+inline const StringKeyContext& StringKeyLess::context() const
+{
+	return mContext;
+}
+
+inline StringKeyContext& StringKeyLess::context()
+{
+	return mContext;
+}
+
+/**
+* String keys are compared once per call, with a single memcmp.
+*/
+template <>
+struct KeyOrder<StringKeyLess>
+{
+	template <typename A, typename B>
+	static int compare(const StringKeyLess&, const A& a, const B& b)
+	{
+		std::pair<const char*, std::size_t> x = stringKeyBytes(a);
+		std::pair<const char*, std::size_t> y = stringKeyBytes(b);
+		int c = stringKeyCompare(x.first, x.second, y.first, y.second);
+		return (c < 0) ? -1 : (c > 0 ? 1 : 0);
+	}
+};
+
+/**
+* The probe for StringKeyNode. It takes the search key's window once, on the stack, and then decides most
+* nodes by comparing windows. A key without the tree's common prefix has no comparable window, and ties
+* and stale windows fall back to a full compare. Nothing is written, so lookups can run side by side.
+*/
+template <typename Value, typename K>
+class NodeProbe<StringKeyNode<Value>, K, StringKeyLess>
+{
+public:
+	NodeProbe(const K& key, const StringKeyLess& comp)
+		: mKey(key)
+		, mCompare(comp)
+		, mPrefix(0)
+	{
+		std::pair<const char*, std::size_t> bytes = stringKeyBytes(key);
+		const StringKeyContext& context = comp.context();
+		mSkip = static_cast<uint32_t>(context.skip);
+		mStamp = 0;
+		if(context.stamp != 0 && stringKeyCommon(bytes.first, bytes.second, context.anchor.data(),
+			context.anchor.size(), context.skip) == context.skip)
+		{
+			mStamp = context.stamp;
+			mPrefix = stringKeyPrefix(bytes.first, bytes.second, mSkip);
+		}
+	}
+
+	int compare(const StringKeyNode<Value>* node) const
+	{
+		if(node->getPrefixSkip() == mSkip && node->getPrefixStamp() == mStamp)
+		{
+			if(mPrefix < node->getPrefix()) return -1;
+			if(mPrefix > node->getPrefix()) return 1;
+		}
+		return KeyOrder<StringKeyLess>::compare(mCompare, mKey, node->getKey());
+	}
+
+private:
+	const K& mKey;
+	const StringKeyLess& mCompare;
+	uint32_t mSkip;
+	uint32_t mStamp;
+	uint64_t mPrefix;
+};
+
+/**
+* Windows for StringKeyNode. A new key narrows the common prefix to what it shares with the anchor
+* (the first key becomes the anchor) and has its window taken at the result. A splay retakes stale
+* windows of the nodes it passes, provided their key has the common prefix too; a node moved over from
+* another tree may not.
+*/
+template <typename Value>
+struct NodeKeyCache<StringKeyNode<Value>, StringKeyLess>
+{
+	static void keyed(StringKeyNode<Value>* node, StringKeyLess& comp)
+	{
+		StringKeyContext& context = comp.context();
+		const std::string& key = node->getKey();
+		if(context.stamp == 0)
+		{
+			context.anchor = key;
+			context.skip = key.size();
+			context.stamp = StringKeyContext::nextStamp();
+		}
+		else context.skip = stringKeyCommon(key.data(), key.size(), context.anchor.data(), context.anchor.size(), context.skip);
+		node->cachePrefix(stringKeyPrefix(key.data(), key.size(), context.skip),
+			static_cast<uint32_t>(context.skip), context.stamp);
+	}
+
+	static void refresh(StringKeyNode<Value>* node, const StringKeyLess& comp)
+	{
+		const StringKeyContext& context = comp.context();
+		if(node->getPrefixSkip() == context.skip && node->getPrefixStamp() == context.stamp) return;
+		const std::string& key = node->getKey();
+		if(context.stamp == 0 || stringKeyCommon(key.data(), key.size(), context.anchor.data(),
+			context.anchor.size(), context.skip) != context.skip) return;
+		node->cachePrefix(stringKeyPrefix(key.data(), key.size(), context.skip),
+			static_cast<uint32_t>(context.skip), context.stamp);
+	}
+};
+
+/*
+	----------------------------------------------------------------
+	End implementations for the StringKeyContext/StringKeyLess class.
+	----------------------------------------------------------------
+*/
+
+/*
+	-------------------------------------------------
+	Begin implementations for the StringKeyNode class.
+	-------------------------------------------------
+*/
+
+/**
+* Explicit constructor that initializes a node with a key, a value and a parent. The prefix window is
+* filled in once the tree has the node (see NodeKeyCache).
+*/
+template<typename Value>
+StringKeyNode<Value>::StringKeyNode(const std::string& key, const Value& value, StringKeyNode<Value>* parent)
+	: mPrefix(0)
+	, mPrefixSkip(NO_PREFIX)
+	, mPrefixStamp(0)
+	, mParent(parent)
+	, mLeft(NULL)
+	, mRight(NULL)
+	, mItem(key, value)
+{
+
+}
+
+template<typename Value>
+const std::pair<const std::string, Value>& StringKeyNode<Value>::getItem() const
+{
+	return mItem;
+}
+
+template<typename Value>
+std::pair<const std::string, Value>& StringKeyNode<Value>::getItem()
+{
+	return mItem;
+}
+
+template<typename Value>
+const std::string& StringKeyNode<Value>::getKey() const
+{
+	return mItem.first;
+}
+
+template<typename Value>
+const Value& StringKeyNode<Value>::getValue() const
+{
+	return mItem.second;
+}
+
+template<typename Value>
+Value& StringKeyNode<Value>::getValue()
+{
+	return mItem.second;
+}
+
+template<typename Value>
+StringKeyNode<Value>* StringKeyNode<Value>::getParent() const
+{
+	return mParent;
+}
+
+template<typename Value>
+StringKeyNode<Value>* StringKeyNode<Value>::getLeft() const
+{
+	return mLeft;
+}
+
+template<typename Value>
+StringKeyNode<Value>* StringKeyNode<Value>::getRight() const
+{
+	return mRight;
+}
+
+template<typename Value>
+void StringKeyNode<Value>::setParent(StringKeyNode<Value>* parent)
+{
+	mParent = parent;
+}
+
+template<typename Value>
+void StringKeyNode<Value>::setLeft(StringKeyNode<Value>* left)
+{
+	mLeft = left;
+}
+
+template<typename Value>
+void StringKeyNode<Value>::setRight(StringKeyNode<Value>* right)
+{
+	mRight = right;
+}
+
+//see NodeBase::setKey; the window is dropped until the tree takes it again
+template<typename Value>
+void StringKeyNode<Value>::setKey(const std::string& key)
+{
+	const_cast<std::string&>(mItem.first) = key;
+	mPrefixSkip = NO_PREFIX;
+	mPrefixStamp = 0;
+}
+
+template<typename Value>
+void StringKeyNode<Value>::setValue(const Value& value)
+{
+	mItem.second = value;
+}
+
+//splay nodes cache nothing about their subtree
+template<typename Value>
+void StringKeyNode<Value>::recompute()
+{
+
+}
+
+//nor keep any balancing state
+template<typename Value>
+void StringKeyNode<Value>::copyBalance(const StringKeyNode<Value>&)
+{
+
+}
+
+template<typename Value>
+uint64_t StringKeyNode<Value>::getPrefix() const
+{
+	return mPrefix;
+}
+
+template<typename Value>
+uint32_t StringKeyNode<Value>::getPrefixSkip() const
+{
+	return mPrefixSkip;
+}
+
+template<typename Value>
+uint32_t StringKeyNode<Value>::getPrefixStamp() const
+{
+	return mPrefixStamp;
+}
+
+//records the key's window at the given common prefix length of the anchor with the given stamp
+template<typename Value>
+void StringKeyNode<Value>::cachePrefix(uint64_t prefix, uint32_t skip, uint32_t stamp)
+{
+	mPrefix = prefix;
+	mPrefixSkip = skip;
+	mPrefixStamp = stamp;
+}
+
+/*
+	-----------------------------------------------
+	End implementations for the StringKeyNode class.
+	-----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef TREAP_H
+#define TREAP_H
+
+#include <cstdint>
+#include "rotateBST.h"
+
+/**
+* The node layout used by Treap: the item, the links and a random heap priority.
+*/
+template <typename Key, typename Value>
+class TreapNode : public NodeBase<Key, Value, TreapNode<Key, Value> >
+{
+public:
+	TreapNode(const Key& key, const Value& value, TreapNode<Key, Value>* parent);
+
+	uint32_t getPriority() const;
+	void setPriority(uint32_t priority);
+	void copyBalance(const TreapNode<Key, Value>& other);
+
+protected:
+	uint32_t mPriority;
+};
+
+template <typename Key, typename Value>
+TreapNode<Key, Value>::TreapNode(const Key& key, const Value& value, TreapNode<Key, Value>* parent)
+	: NodeBase<Key, Value, TreapNode<Key, Value> >(key, value, parent)
+	, mPriority(0)
+{
+
+}
+
+template <typename Key, typename Value>
+uint32_t TreapNode<Key, Value>::getPriority() const
+{
+	return mPriority;
+}
+
+template <typename Key, typename Value>
+void TreapNode<Key, Value>::setPriority(uint32_t priority)
+{
+	mPriority = priority;
+}
+
+//a copied tree keeps its priorities, so later inserts still see a heap
+template <typename Key, typename Value>
+void TreapNode<Key, Value>::copyBalance(const TreapNode<Key, Value>& other)
+{
+	mPriority = other.mPriority;
+}
+
+/**
+* A treap (Seidel and Aragon): a search tree on the keys that is also a max-heap on random priorities,
+* which makes its shape that of a random binary search tree whatever the insertion order. Every lookup
+* is O(log n) with high probability, and an insert or remove does O(1) rotations on average. The
+* interface is the same as SplayTree's, and lookups do not restructure the tree.
+*/
+template <typename Key, typename Value, typename NodeType = TreapNode<Key, Value>,
+	typename Alloc = std::allocator<std::pair<const Key, Value> >, typename Compare = std::less<Key> >
+class Treap : public rotateBST<Key, Value, NodeType, Alloc, Compare>
+{
+public:
+	explicit Treap(const Alloc& alloc = Alloc());
+	explicit Treap(const Compare& comp, const Alloc& alloc = Alloc());
+	typename Treap<Key, Value, NodeType, Alloc, Compare>::iterator insert(const std::pair<const Key, Value>& keyValuePair);
+	void remove(const Key& key);
+	void deleteMinLeaf();
+protected:
+	uint32_t nextPriority();
+
+	uint32_t mSeed;
+private:
+	//these reshape the tree by rotations alone, which would leave the priorities behind
+	using rotateBST<Key, Value, NodeType, Alloc, Compare>::transform;
+	using rotateBST<Key, Value, NodeType, Alloc, Compare>::rebalance;
+};
+
+//each tree seeds its own generator, so trees built from the same keys still get different shapes
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+Treap<Key, Value, NodeType, Alloc, Compare>::Treap(const Alloc& alloc)
+	: rotateBST<Key, Value, NodeType, Alloc, Compare>(alloc)
+	, mSeed(static_cast<uint32_t>((reinterpret_cast<uintptr_t>(this) >> 4) * 2654435761u) | 1u)
+{
+
+}
+
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+Treap<Key, Value, NodeType, Alloc, Compare>::Treap(const Compare& comp, const Alloc& alloc)
+	: rotateBST<Key, Value, NodeType, Alloc, Compare>(comp, alloc)
+	, mSeed(static_cast<uint32_t>((reinterpret_cast<uintptr_t>(this) >> 4) * 2654435761u) | 1u)
+{
+
+}
+
+/**
+* Inserts a key/value pair, or overwrites the value if the key is already present. The new node gets a
+* random priority and is rotated up while it outranks its parent. Returns an iterator to the item.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+typename Treap<Key, Value, NodeType, Alloc, Compare>::iterator Treap<Key, Value, NodeType, Alloc, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+	if(this->mRoot == nullptr)
+	{
+		this->mRoot = this->createNode(keyValuePair.first, keyValuePair.second, nullptr);
+		this->mRoot->setPriority(nextPriority());
+		return typename Treap<Key, Value, NodeType, Alloc, Compare>::iterator(this->mRoot, this);
+	}
+	NodeType* curr = this->mRoot;
+	int c;
+	while((c = this->compareKeys(keyValuePair.first, curr->getKey())) != 0)
+	{
+		NodeType* next = c < 0 ? curr->getLeft() : curr->getRight();
+		if(next == nullptr)
+		{
+			NodeType* new_node = this->createNode(keyValuePair.first, keyValuePair.second, curr);
+			new_node->setPriority(nextPriority());
+			if(c < 0) curr->setLeft(new_node);
+			else curr->setRight(new_node);
+			while(new_node->getParent() != nullptr && new_node->getParent()->getPriority() < new_node->getPriority())
+			{
+				if(new_node == new_node->getParent()->getLeft()) this->rightRotate(new_node);
+				else this->leftRotate(new_node);
+			}
+			return typename Treap<Key, Value, NodeType, Alloc, Compare>::iterator(new_node, this);
+		}
+		curr = next;
+	}
+	//key already in the tree, overwrite the value
+	curr->setValue(keyValuePair.second);
+	return typename Treap<Key, Value, NodeType, Alloc, Compare>::iterator(curr, this);
+}
+
+/**
+* Removes a key if it is present. The node is rotated down, always lifting its higher priority child,
+* until it has at most one child and can be spliced out.
+*/
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void Treap<Key, Value, NodeType, Alloc, Compare>::remove(const Key& key)
+{
+	NodeType* node = this->internalFind(key);
+	if(node == nullptr) return;
+	while(node->getLeft() != nullptr && node->getRight() != nullptr)
+	{
+		if(node->getLeft()->getPriority() > node->getRight()->getPriority()) this->rightRotate(node->getLeft());
+		else this->leftRotate(node->getRight());
+	}
+	this->spliceOut(node);
+}
+
+//removes the leaf reached by going left where possible
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+void Treap<Key, Value, NodeType, Alloc, Compare>::deleteMinLeaf()
+{
+	NodeType* leaf = this->getMinLeaf();
+	if(leaf != nullptr) this->spliceOut(leaf);
+}
+
+//xorshift32, plenty for balancing and cheap enough to run on every insert
+template <typename Key, typename Value, typename NodeType, typename Alloc, typename Compare>
+uint32_t Treap<Key, Value, NodeType, Alloc, Compare>::nextPriority()
+{
+	mSeed ^= mSeed << 13;
+	mSeed ^= mSeed >> 17;
+	mSeed ^= mSeed << 5;
+	return mSeed;
+}
+
+#endif